@@ -0,0 +1,186 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <cxxopts.hpp>
+
+#include "checksum_log.h"
+
+struct Config {
+  std::string reference;
+  std::string received;
+  uint32_t max_errors;
+};
+
+void ParseCommandLine(int argc, char** argv, Config& config) {
+  try {
+    std::string program_name = argv[0];
+    cxxopts::Options options(program_name, "");
+
+    options.add_option("", {"h, help", "Print help"});
+
+    options.add_option(
+        "", {"r, reference", "Checksum log of the frames sent, e.g. capture",
+             cxxopts::value<std::string>()});
+    options.add_option(
+        "", {"c, received", "Checksum log of the frames received",
+             cxxopts::value<std::string>()});
+    options.add_option("", {"max_errors", "Mismatches printed in detail",
+                            cxxopts::value<uint32_t>()->default_value("10")});
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help") || !result.count("reference") ||
+        !result.count("received")) {
+      std::cout << options.help() << std::endl;
+      exit(0);
+    }
+
+    config.reference = result["reference"].as<std::string>();
+    config.received = result["received"].as<std::string>();
+    config.max_errors = result["max_errors"].as<uint32_t>();
+  } catch (const cxxopts::exceptions::exception& e) {
+    std::cout << "error parsing options: " << e.what() << std::endl;
+    exit(-1);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  Config config;
+  ParseCommandLine(argc, argv, config);
+
+  std::vector<std::pair<uint32_t, uint32_t>> reference;
+  std::vector<std::pair<uint32_t, uint32_t>> received;
+  if (!ChecksumLog::Load(config.reference, &reference) ||
+      !ChecksumLog::Load(config.received, &received)) {
+    return -1;
+  }
+
+  // Position of each frame in the reference, by sequence and checksum, and
+  // the positions of every checksum in order. Identical frames, e.g. of a
+  // static scene, share a checksum and are told apart by their sequence.
+  // A frame the sender repeated, e.g. while its capture recovers, is logged
+  // again under the same sequence and kept once.
+  auto key = [](uint32_t sequence, uint32_t checksum) {
+    return uint64_t(sequence) << 32 | checksum;
+  };
+  std::unordered_map<uint64_t, size_t> positions;
+  std::unordered_map<uint32_t, std::vector<size_t>> checksum_positions;
+  for (size_t i = 0; i < reference.size(); i++) {
+    if (positions.emplace(key(reference[i].first, reference[i].second), i)
+            .second) {
+      checksum_positions[reference[i].second].push_back(i);
+    }
+  }
+
+  // Walk the received frames in order. A frame is out of order when it
+  // comes from earlier in the reference than the newest frame seen so far.
+  // A receiver reading another device, e.g. a loopback, counts sequences
+  // from its own start, so they are matched at the offset of the last
+  // match.
+  std::vector<bool> seen(reference.size());
+  uint64_t matched = 0;
+  uint64_t corrupted = 0;
+  uint64_t repeated = 0;
+  uint64_t reordered = 0;
+  uint32_t errors = 0;
+  size_t newest = 0;
+  int64_t offset = 0;
+  for (const auto& [sequence, checksum] : received) {
+    auto it = checksum_positions.find(checksum);
+    if (it == checksum_positions.end()) {
+      corrupted++;
+      if (errors++ < config.max_errors) {
+        std::cout << "received " << sequence << ": checksum " << std::hex
+                  << std::setw(8) << std::setfill('0') << checksum << std::dec
+                  << std::setfill(' ') << " not in reference" << std::endl;
+      }
+      continue;
+    }
+
+    // The frame at the expected sequence, else the next one with this
+    // checksum after the newest frame, else the last one before it
+    size_t position;
+    auto exact = positions.find(key(uint32_t(sequence - offset), checksum));
+    if (exact != positions.end()) {
+      position = exact->second;
+    } else {
+      const std::vector<size_t>& candidates = it->second;
+      auto next = matched ? std::upper_bound(candidates.begin(),
+                                             candidates.end(), newest)
+                          : candidates.begin();
+      position = next != candidates.end() ? *next : candidates.back();
+    }
+    offset = int64_t(sequence) - reference[position].first;
+    if (seen[position]) {
+      repeated++;
+    } else if (matched && position < newest) {
+      reordered++;
+      if (errors++ < config.max_errors) {
+        std::cout << "received " << sequence << ": reference "
+                  << reference[position].first << " after reference "
+                  << reference[newest].first << std::endl;
+      }
+    }
+    seen[position] = true;
+    newest = matched ? std::max(newest, position) : position;
+    matched++;
+  }
+
+  // Reference frames up to the newest one received that never arrived;
+  // the frames before the first match were sent before the receiver
+  // started
+  uint64_t dropped = 0;
+  size_t first = reference.size();
+  for (size_t i = 0; i < reference.size(); i++) {
+    if (seen[i]) {
+      first = std::min(first, i);
+    }
+  }
+  for (size_t i = first; i <= newest && i < reference.size(); i++) {
+    const auto& [sequence, checksum] = reference[i];
+    dropped += !seen[i] && positions.at(key(sequence, checksum)) == i;
+  }
+
+  std::cout << "Reference " << reference.size() << " frames, received "
+            << received.size() << ": matched " << matched << ", corrupted "
+            << corrupted << ", repeated " << repeated << ", out of order "
+            << reordered << ", dropped " << dropped << std::endl;
+
+  return corrupted || reordered ? 1 : 0;
+}
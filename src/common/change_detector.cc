@@ -0,0 +1,159 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <linux/videodev2.h>
+
+#include "change_detector.h"
+#include "check.h"
+
+namespace {
+
+// Sampling grid: one 16-byte block every kColumnStep bytes of every
+// kRowStep-th row
+constexpr uint32_t kBlockBytes = 16;
+constexpr uint32_t kColumnStep = 64;
+constexpr uint32_t kRowStep = 8;
+
+// Sum of absolute differences of the bytes of two blocks selected by
+// `mask`, 0xff for luma bytes and 0x00 for chroma bytes
+uint32_t sad_block(const uint8_t* a, const uint8_t* b, const uint8_t* mask) {
+#if defined(__x86_64__) || defined(__i386__)
+  const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask));
+  const __m128i va = _mm_and_si128(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(a)), m);
+  const __m128i vb = _mm_and_si128(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(b)), m);
+  // Two partial sums, one per 8-byte half
+  const __m128i sad = _mm_sad_epu8(va, vb);
+  return _mm_cvtsi128_si32(sad) + _mm_extract_epi16(sad, 4);
+#else
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < kBlockBytes; i++) {
+    sum += abs(int(a[i] & mask[i]) - int(b[i] & mask[i]));
+  }
+  return sum;
+#endif
+}
+
+}  // namespace
+
+ChangeDetector::ChangeDetector(uint32_t pixelformat,
+                               uint32_t width,
+                               uint32_t height,
+                               double threshold,
+                               uint32_t hold_frames,
+                               uint32_t keepalive_frames)
+    : m_height(height),
+      m_packed(pixelformat == V4L2_PIX_FMT_YUYV),
+      m_threshold(threshold),
+      m_hold_frames(hold_frames),
+      m_keepalive_frames(keepalive_frames) {
+  m_row_bytes = m_packed ? width * 2 : width;
+  CHECK(m_row_bytes >= kBlockBytes);
+
+  const uint32_t rows = (m_height + kRowStep - 1) / kRowStep;
+  const uint32_t blocks = (m_row_bytes - kBlockBytes) / kColumnStep + 1;
+  m_samples.resize(size_t(rows) * blocks * kBlockBytes);
+  m_luma_samples =
+      uint64_t(rows) * blocks * (m_packed ? kBlockBytes / 2 : kBlockBytes);
+}
+
+uint64_t ChangeDetector::SampleAndCompare(const uint8_t* data,
+                                          uint32_t stride) {
+  // YUYV carries luma in the even bytes
+  uint8_t mask[kBlockBytes];
+  for (uint32_t i = 0; i < kBlockBytes; i++) {
+    mask[i] = !m_packed || i % 2 == 0 ? 0xff : 0x00;
+  }
+
+  uint64_t sad = 0;
+  uint8_t* samples = m_samples.data();
+  for (uint32_t y = 0; y < m_height; y += kRowStep) {
+    const uint8_t* row = data + size_t(y) * stride;
+    for (uint32_t x = 0; x + kBlockBytes <= m_row_bytes; x += kColumnStep) {
+      sad += sad_block(row + x, samples, mask);
+      memcpy(samples, row + x, kBlockBytes);
+      samples += kBlockBytes;
+    }
+  }
+  return sad;
+}
+
+bool ChangeDetector::Update(const uint8_t* data, uint32_t stride) {
+  const auto start = std::chrono::steady_clock::now();
+  const uint64_t sad = SampleAndCompare(data, stride);
+  m_sample_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  // The first frame has nothing to compare with and is always forwarded
+  const bool changed =
+      m_frames++ == 0 || double(sad) / m_luma_samples >= m_threshold;
+  if (changed) {
+    m_quiet_frames = 0;
+    m_static = false;
+    return true;
+  }
+
+  if (!m_static) {
+    if (++m_quiet_frames < m_hold_frames) {
+      return true;
+    }
+    m_static = true;
+    m_static_frames = 0;
+    m_static_periods++;
+  }
+
+  // Keep consumers alive with an occasional frame
+  m_static_frames++;
+  if (m_keepalive_frames && m_static_frames % m_keepalive_frames == 0) {
+    return true;
+  }
+  m_skipped++;
+  return false;
+}
+
+void ChangeDetector::Report() const {
+  std::cout << "Change detection: frames " << m_frames << ", skipped "
+            << m_skipped << ", static periods " << m_static_periods;
+  if (m_frames) {
+    std::cout << ", " << m_sample_ns / 1000 / m_frames << " us/frame";
+  }
+  std::cout << std::endl;
+}
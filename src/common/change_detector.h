@@ -0,0 +1,90 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __CHANGE_DETECTOR_H__
+#define __CHANGE_DETECTOR_H__
+
+#include <cstdint>
+#include <vector>
+
+// Decides which frames of a mostly static scene are worth forwarding.
+//
+// Each frame is sampled on a sparse luma grid, 16 bytes every 64 bytes of
+// every 8th row, and compared with the samples of the previous frame by a
+// SIMD sum of absolute differences. The scene turns static once the mean
+// luma difference stayed below `threshold` for `hold_frames` frames in a
+// row, and moving again on the first frame above it. While static only
+// every `keepalive_frames`th frame is forwarded, or none when zero.
+class ChangeDetector {
+ public:
+  // `pixelformat` is V4L2_PIX_FMT_YUYV or a format with an 8-bit luma
+  // plane first, e.g. NV12 or YUV420
+  ChangeDetector(uint32_t pixelformat,
+                 uint32_t width,
+                 uint32_t height,
+                 double threshold,
+                 uint32_t hold_frames,
+                 uint32_t keepalive_frames);
+
+  // Samples a frame and returns whether it should be forwarded
+  bool Update(const uint8_t* data, uint32_t stride);
+
+  bool IsStatic() const { return m_static; }
+  uint64_t GetSkippedFrames() const { return m_skipped; }
+
+  void Report() const;
+
+ private:
+  // Sums the absolute luma differences between `data` and the stored
+  // samples, and stores the samples of `data`
+  uint64_t SampleAndCompare(const uint8_t* data, uint32_t stride);
+
+  uint32_t m_height;
+  uint32_t m_row_bytes;
+  bool m_packed;
+
+  double m_threshold;
+  uint32_t m_hold_frames;
+  uint32_t m_keepalive_frames;
+
+  // Samples of the previous frame and the luma samples they hold
+  std::vector<uint8_t> m_samples;
+  uint64_t m_luma_samples = 0;
+
+  bool m_static = false;
+  uint32_t m_quiet_frames = 0;
+  uint32_t m_static_frames = 0;
+
+  uint64_t m_frames = 0;
+  uint64_t m_skipped = 0;
+  uint64_t m_static_periods = 0;
+  uint64_t m_sample_ns = 0;
+};
+#endif /* __CHANGE_DETECTOR_H__ */
@@ -33,7 +33,13 @@
 
 #include <iostream>
 
+// Run before aborting, e.g. to write out queued log lines
+inline void (*g_check_failed_hook)() = nullptr;
+
 inline void check_failed(const char* expr, const char* file, int line) {
+  if (g_check_failed_hook) {
+    g_check_failed_hook();
+  }
   std::cerr << "CHECK FAILED: " << expr << " in " << file << ":" << line
             << std::endl;
   std::abort();
@@ -0,0 +1,113 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <chrono>
+#include <iostream>
+
+#include "checksum_log.h"
+#include "checksum_utils.h"
+
+ChecksumLog::ChecksumLog(const std::string& path) {
+  if (path.empty()) {
+    return;
+  }
+
+  m_file = fopen(path.c_str(), "w");
+  if (!m_file) {
+    std::cout << "Could not open checksum log " << path << std::endl;
+    return;
+  }
+  // Lines are small and frequent, keep them off the streaming path
+  setvbuf(m_file, nullptr, _IOFBF, 1 << 16);
+}
+
+ChecksumLog::~ChecksumLog() {
+  if (m_file) {
+    fclose(m_file);
+    m_file = nullptr;
+  }
+}
+
+uint32_t ChecksumLog::Add(uint32_t sequence,
+                          const uint8_t* data,
+                          uint32_t stride,
+                          uint32_t row_bytes,
+                          uint32_t rows) {
+  const auto start = std::chrono::steady_clock::now();
+  const uint32_t checksum = checksum_plane(data, stride, row_bytes, rows);
+  m_checksum_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  if (m_frames) {
+    if (sequence == m_last_sequence) {
+      m_repeated++;
+    } else if (int32_t(sequence - m_last_sequence) < 0) {
+      m_reordered++;
+    } else if (sequence - m_last_sequence > 1) {
+      m_gaps += sequence - m_last_sequence - 1;
+    }
+  }
+  m_last_sequence = sequence;
+  m_frames++;
+
+  if (m_file) {
+    fprintf(m_file, "%u %08x\n", sequence, checksum);
+  }
+  return checksum;
+}
+
+void ChecksumLog::Report(const char* name) const {
+  std::cout << "Checksum " << name << " (" << checksum_impl_name()
+            << "): frames " << m_frames << ", sequence gaps " << m_gaps
+            << ", repeated " << m_repeated << ", out of order "
+            << m_reordered;
+  if (m_frames) {
+    std::cout << ", " << m_checksum_ns / 1000 / m_frames << " us/frame";
+  }
+  std::cout << std::endl;
+}
+
+bool ChecksumLog::Load(const std::string& path,
+                       std::vector<std::pair<uint32_t, uint32_t>>* entries) {
+  FILE* file = fopen(path.c_str(), "r");
+  if (!file) {
+    std::cout << "Could not open checksum log " << path << std::endl;
+    return false;
+  }
+
+  uint32_t sequence;
+  uint32_t checksum;
+  while (fscanf(file, "%u %x", &sequence, &checksum) == 2) {
+    entries->emplace_back(sequence, checksum);
+  }
+  fclose(file);
+  return true;
+}
@@ -0,0 +1,77 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __CHECKSUM_LOG_H__
+#define __CHECKSUM_LOG_H__
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Checksums frames at one point of a pipeline and records them keyed by
+// sequence number, one "<sequence> <checksum>" line per frame, so logs
+// taken at different points can be compared with checksum_compare.
+// Sequence gaps, repeated sequence numbers and sequence numbers going
+// backwards are counted on the way.
+class ChecksumLog {
+ public:
+  // An empty `path` only counts and checksums without writing a log
+  explicit ChecksumLog(const std::string& path);
+  ~ChecksumLog();
+
+  bool IsOpen() const { return m_file != nullptr; }
+
+  // Checksums the active area of a plane, see checksum_plane(), records it
+  // under `sequence` and returns it.
+  uint32_t Add(uint32_t sequence,
+               const uint8_t* data,
+               uint32_t stride,
+               uint32_t row_bytes,
+               uint32_t rows);
+
+  void Report(const char* name) const;
+
+  // Reads a log written by ChecksumLog as (sequence, checksum) pairs
+  static bool Load(const std::string& path,
+                   std::vector<std::pair<uint32_t, uint32_t>>* entries);
+
+ private:
+  FILE* m_file = nullptr;
+
+  uint64_t m_frames = 0;
+  uint64_t m_gaps = 0;
+  uint64_t m_repeated = 0;
+  uint64_t m_reordered = 0;
+  uint32_t m_last_sequence = 0;
+  uint64_t m_checksum_ns = 0;
+};
+#endif /* __CHECKSUM_LOG_H__ */
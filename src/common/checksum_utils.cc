@@ -0,0 +1,171 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include <cstring>
+
+#include "checksum_utils.h"
+
+namespace {
+
+// CRC32C (Castagnoli), reflected polynomial
+constexpr uint32_t kPolynomial = 0x82f63b78;
+
+struct Crc32cTable {
+  uint32_t entries[256];
+
+  constexpr Crc32cTable() : entries() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ (kPolynomial & (0u - (crc & 1)));
+      }
+      entries[i] = crc;
+    }
+  }
+};
+
+constexpr Crc32cTable kTable;
+
+uint32_t crc32c_bytes(uint32_t crc, const uint8_t* data, uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    crc = kTable.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+uint32_t crc32c_u32(uint32_t crc, uint32_t value) {
+  uint8_t bytes[4];
+  memcpy(bytes, &value, sizeof(bytes));
+  return crc32c_bytes(crc, bytes, sizeof(bytes));
+}
+
+uint32_t checksum_plane_c(const uint8_t* data,
+                          uint32_t stride,
+                          uint32_t row_bytes,
+                          uint32_t rows) {
+  uint32_t crc = ~0u;
+  for (uint32_t y = 0; y < rows; y++) {
+    const uint32_t row_crc =
+        ~crc32c_bytes(~0u, data + size_t(y) * stride, row_bytes);
+    crc = crc32c_u32(crc, row_crc);
+  }
+  return ~crc;
+}
+
+// _mm_crc32_u64 exists on x86-64 only
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) uint32_t crc32c_row_sse42(uint32_t crc,
+                                                            const uint8_t* row,
+                                                            uint32_t len) {
+  uint32_t x = 0;
+  for (; x + 8 <= len; x += 8) {
+    uint64_t value;
+    memcpy(&value, row + x, sizeof(value));
+    crc = _mm_crc32_u64(crc, value);
+  }
+  for (; x < len; x++) {
+    crc = _mm_crc32_u8(crc, row[x]);
+  }
+  return crc;
+}
+
+__attribute__((target("sse4.2"))) uint32_t checksum_plane_sse42(
+    const uint8_t* data,
+    uint32_t stride,
+    uint32_t row_bytes,
+    uint32_t rows) {
+  uint32_t crc = ~0u;
+  uint32_t y = 0;
+
+  // crc32 has a latency of three cycles and a throughput of one, so four
+  // independent row chains keep the unit busy
+  for (; y + 4 <= rows; y += 4) {
+    const uint8_t* r0 = data + size_t(y) * stride;
+    const uint8_t* r1 = r0 + stride;
+    const uint8_t* r2 = r1 + stride;
+    const uint8_t* r3 = r2 + stride;
+    uint64_t c0 = ~0u;
+    uint64_t c1 = ~0u;
+    uint64_t c2 = ~0u;
+    uint64_t c3 = ~0u;
+    uint32_t x = 0;
+    for (; x + 8 <= row_bytes; x += 8) {
+      uint64_t v0, v1, v2, v3;
+      memcpy(&v0, r0 + x, sizeof(v0));
+      memcpy(&v1, r1 + x, sizeof(v1));
+      memcpy(&v2, r2 + x, sizeof(v2));
+      memcpy(&v3, r3 + x, sizeof(v3));
+      c0 = _mm_crc32_u64(c0, v0);
+      c1 = _mm_crc32_u64(c1, v1);
+      c2 = _mm_crc32_u64(c2, v2);
+      c3 = _mm_crc32_u64(c3, v3);
+    }
+    const uint32_t len = row_bytes - x;
+    crc = _mm_crc32_u32(crc, ~crc32c_row_sse42(c0, r0 + x, len));
+    crc = _mm_crc32_u32(crc, ~crc32c_row_sse42(c1, r1 + x, len));
+    crc = _mm_crc32_u32(crc, ~crc32c_row_sse42(c2, r2 + x, len));
+    crc = _mm_crc32_u32(crc, ~crc32c_row_sse42(c3, r3 + x, len));
+  }
+  for (; y < rows; y++) {
+    const uint8_t* row = data + size_t(y) * stride;
+    crc = _mm_crc32_u32(crc, ~crc32c_row_sse42(~0u, row, row_bytes));
+  }
+  return ~crc;
+}
+#endif
+
+using ChecksumFunc = uint32_t (*)(const uint8_t*, uint32_t, uint32_t, uint32_t);
+
+ChecksumFunc select_checksum() {
+#if defined(__x86_64__)
+  if (__builtin_cpu_supports("sse4.2")) {
+    return checksum_plane_sse42;
+  }
+#endif
+  return checksum_plane_c;
+}
+
+}  // namespace
+
+uint32_t checksum_plane(const uint8_t* data,
+                        uint32_t stride,
+                        uint32_t row_bytes,
+                        uint32_t rows) {
+  static const ChecksumFunc func = select_checksum();
+  return func(data, stride, row_bytes, rows);
+}
+
+const char* checksum_impl_name() {
+  return select_checksum() == checksum_plane_c ? "c" : "sse4.2";
+}
@@ -28,36 +28,24 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
-#ifndef __CAPTURE_DEVICE_MMAP_H__
-#define __CAPTURE_DEVICE_MMAP_H__
+#ifndef __CHECKSUM_UTILS_H__
+#define __CHECKSUM_UTILS_H__
 
 #include <cstdint>
 
-#include <vector>
-
-#include "v4l2_device.h"
-
-class CaptureDeviceMmap : public V4L2Device {
- public:
-  CaptureDeviceMmap(int fd, int width, int height, bool use_expbuf = false);
-  ~CaptureDeviceMmap();
-
-  void Initialize(int buffer_count) override;
-  void Start() override;
-
-  void Queue(V4L2DeviceBuffer device_buffer) override;
-  V4L2DeviceBuffer Dequeue() override;
-
- private:
-  void Queue(uint32_t index);
-  V4L2DeviceBuffer DequeueMmap();
-
-  int m_fd;
-  int m_width;
-  int m_height;
-
-  bool m_use_expbuf;
-
-  std::vector<V4L2DeviceBuffer> m_device_buffers;
-};
-#endif /* __CAPTURE_DEVICE_MMAP_H__ */
+// Frame checksum for verifying that frames survive a pipeline unchanged.
+//
+// Every row of `row_bytes` is hashed with CRC32C, skipping the stride
+// padding, and the frame checksum is the CRC32C of the row checksums in
+// order. Hashing rows independently lets four rows be hashed in parallel
+// with the SSE4.2 crc32 instruction, hiding its latency. The result depends
+// only on the active pixels, so frames with different strides compare
+// equal.
+uint32_t checksum_plane(const uint8_t* data,
+                        uint32_t stride,
+                        uint32_t row_bytes,
+                        uint32_t rows);
+
+// Name of the implementation selected for this CPU
+const char* checksum_impl_name();
+#endif /* __CHECKSUM_UTILS_H__ */
@@ -0,0 +1,267 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COPY_X86 1
+#endif
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "check.h"
+#include "copy_utils.h"
+
+namespace {
+
+// Copies of less than this go through memcpy, where the destination is
+// likely still cache resident when the consumer reads it
+constexpr size_t kMinStreamBytes = 256 * 1024;
+// How far ahead of the loads the source is prefetched
+constexpr size_t kPrefetchDistance = 1024;
+
+void copy_plane_memcpy(uint8_t* dst,
+                       uint32_t dst_stride,
+                       const uint8_t* src,
+                       uint32_t src_stride,
+                       uint32_t row_bytes,
+                       uint32_t rows) {
+  if (dst_stride == row_bytes && src_stride == row_bytes) {
+    memcpy(dst, src, size_t(row_bytes) * rows);
+    return;
+  }
+  for (uint32_t y = 0; y < rows; y++) {
+    memcpy(dst + size_t(y) * dst_stride, src + size_t(y) * src_stride,
+           row_bytes);
+  }
+}
+
+#if defined(COPY_X86)
+// Each row is copied with memcpy up to the first aligned destination
+// address, then with unaligned loads and aligned streaming stores, and the
+// remainder with memcpy again. The source is prefetched into L1; an NTA
+// hint measured about twice slower on 4K frames.
+
+__attribute__((target("sse2"))) void stream_row_sse2(uint8_t* dst,
+                                                      const uint8_t* src,
+                                                      size_t n) {
+  const size_t head = std::min(n, (0 - uintptr_t(dst)) & 15);
+  memcpy(dst, src, head);
+  dst += head;
+  src += head;
+  n -= head;
+
+  for (; n >= 64; n -= 64, dst += 64, src += 64) {
+    _mm_prefetch(reinterpret_cast<const char*>(src + kPrefetchDistance),
+                 _MM_HINT_T0);
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst), a);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), b);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), c);
+    _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), d);
+  }
+  memcpy(dst, src, n);
+}
+
+__attribute__((target("avx2"))) void stream_row_avx2(uint8_t* dst,
+                                                      const uint8_t* src,
+                                                      size_t n) {
+  const size_t head = std::min(n, (0 - uintptr_t(dst)) & 31);
+  memcpy(dst, src, head);
+  dst += head;
+  src += head;
+  n -= head;
+
+  for (; n >= 128; n -= 128, dst += 128, src += 128) {
+    _mm_prefetch(reinterpret_cast<const char*>(src + kPrefetchDistance),
+                 _MM_HINT_T0);
+    _mm_prefetch(reinterpret_cast<const char*>(src + kPrefetchDistance + 64),
+                 _MM_HINT_T0);
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+    __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+    __m256i c =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 64));
+    __m256i d =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 96));
+    _mm256_stream_si256(reinterpret_cast<__m256i*>(dst), a);
+    _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 32), b);
+    _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 64), c);
+    _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 96), d);
+  }
+  for (; n >= 32; n -= 32, dst += 32, src += 32) {
+    _mm256_stream_si256(
+        reinterpret_cast<__m256i*>(dst),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+  }
+  memcpy(dst, src, n);
+}
+
+__attribute__((target("avx512f"))) void stream_row_avx512(uint8_t* dst,
+                                                           const uint8_t* src,
+                                                           size_t n) {
+  const size_t head = std::min(n, (0 - uintptr_t(dst)) & 63);
+  memcpy(dst, src, head);
+  dst += head;
+  src += head;
+  n -= head;
+
+  for (; n >= 256; n -= 256, dst += 256, src += 256) {
+    for (size_t line = 0; line < 256; line += 64) {
+      _mm_prefetch(
+          reinterpret_cast<const char*>(src + kPrefetchDistance + line),
+          _MM_HINT_T0);
+    }
+    __m512i a = _mm512_loadu_si512(src);
+    __m512i b = _mm512_loadu_si512(src + 64);
+    __m512i c = _mm512_loadu_si512(src + 128);
+    __m512i d = _mm512_loadu_si512(src + 192);
+    _mm512_stream_si512(reinterpret_cast<__m512i*>(dst), a);
+    _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + 64), b);
+    _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + 128), c);
+    _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + 192), d);
+  }
+  for (; n >= 64; n -= 64, dst += 64, src += 64) {
+    _mm512_stream_si512(reinterpret_cast<__m512i*>(dst),
+                        _mm512_loadu_si512(src));
+  }
+  memcpy(dst, src, n);
+}
+#endif
+
+CopyKernel detect_best_kernel() {
+  for (CopyKernel kernel :
+       {CopyKernel::kAvx512, CopyKernel::kAvx2, CopyKernel::kSse2}) {
+    if (copy_kernel_supported(kernel)) {
+      return kernel;
+    }
+  }
+  return CopyKernel::kMemcpy;
+}
+
+}  // namespace
+
+const char* copy_kernel_name(CopyKernel kernel) {
+  switch (kernel) {
+    case CopyKernel::kMemcpy:
+      return "memcpy";
+    case CopyKernel::kSse2:
+      return "sse2";
+    case CopyKernel::kAvx2:
+      return "avx2";
+    case CopyKernel::kAvx512:
+      return "avx512";
+  }
+  return "unknown";
+}
+
+bool copy_kernel_supported(CopyKernel kernel) {
+  switch (kernel) {
+    case CopyKernel::kMemcpy:
+      return true;
+#if defined(COPY_X86)
+    case CopyKernel::kSse2:
+      return __builtin_cpu_supports("sse2");
+    case CopyKernel::kAvx2:
+      return __builtin_cpu_supports("avx2");
+    case CopyKernel::kAvx512:
+      return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+      return false;
+  }
+}
+
+CopyKernel copy_best_kernel() {
+  static const CopyKernel best = detect_best_kernel();
+  return best;
+}
+
+void copy_plane(uint8_t* dst,
+                uint32_t dst_stride,
+                const uint8_t* src,
+                uint32_t src_stride,
+                uint32_t row_bytes,
+                uint32_t rows) {
+  CopyKernel kernel = copy_best_kernel();
+  if (size_t(row_bytes) * rows < kMinStreamBytes) {
+    kernel = CopyKernel::kMemcpy;
+  }
+  copy_plane_with(kernel, dst, dst_stride, src, src_stride, row_bytes, rows);
+}
+
+void copy_plane_with(CopyKernel kernel,
+                     uint8_t* dst,
+                     uint32_t dst_stride,
+                     const uint8_t* src,
+                     uint32_t src_stride,
+                     uint32_t row_bytes,
+                     uint32_t rows) {
+  CHECK(copy_kernel_supported(kernel));
+
+#if defined(COPY_X86)
+  void (*stream_row)(uint8_t*, const uint8_t*, size_t) = nullptr;
+  switch (kernel) {
+    case CopyKernel::kSse2:
+      stream_row = stream_row_sse2;
+      break;
+    case CopyKernel::kAvx2:
+      stream_row = stream_row_avx2;
+      break;
+    case CopyKernel::kAvx512:
+      stream_row = stream_row_avx512;
+      break;
+    default:
+      break;
+  }
+
+  if (stream_row) {
+    // Contiguous planes are streamed as a single row
+    if (dst_stride == row_bytes && src_stride == row_bytes) {
+      stream_row(dst, src, size_t(row_bytes) * rows);
+    } else {
+      for (uint32_t y = 0; y < rows; y++) {
+        stream_row(dst + size_t(y) * dst_stride, src + size_t(y) * src_stride,
+                   row_bytes);
+      }
+    }
+    // Order the weakly-ordered streaming stores before the buffer is handed
+    // to the device
+    _mm_sfence();
+    return;
+  }
+#endif
+
+  copy_plane_memcpy(dst, dst_stride, src, src_stride, row_bytes, rows);
+}
@@ -0,0 +1,67 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __COPY_UTILS_H__
+#define __COPY_UTILS_H__
+
+#include <cstdint>
+
+// Plane copy kernels. The streaming kernels write the destination with
+// non-temporal stores, bypassing the cache, and prefetch the source ahead.
+// They suit frames written to device buffers that the CPU never reads back.
+enum class CopyKernel { kMemcpy, kSse2, kAvx2, kAvx512 };
+
+const char* copy_kernel_name(CopyKernel kernel);
+
+bool copy_kernel_supported(CopyKernel kernel);
+
+// Returns the fastest kernel supported by this CPU, selected once at
+// runtime.
+CopyKernel copy_best_kernel();
+
+// Copies `rows` rows of `row_bytes` each between planes with independent
+// strides, e.g. into an output buffer with padded bytesperline. Small
+// copies fall back to memcpy.
+void copy_plane(uint8_t* dst,
+                uint32_t dst_stride,
+                const uint8_t* src,
+                uint32_t src_stride,
+                uint32_t row_bytes,
+                uint32_t rows);
+
+// Same as copy_plane with an explicit kernel, which must be supported.
+void copy_plane_with(CopyKernel kernel,
+                     uint8_t* dst,
+                     uint32_t dst_stride,
+                     const uint8_t* src,
+                     uint32_t src_stride,
+                     uint32_t row_bytes,
+                     uint32_t rows);
+#endif /* __COPY_UTILS_H__ */
@@ -0,0 +1,242 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <limits>
+
+#include "dequeue_policy.h"
+#include "logger.h"
+#include "trace.h"
+
+namespace {
+
+// Spin window around the expected frame arrival, at least this long and
+// otherwise an eighth of the frame interval
+constexpr int64_t kMinSpinWindowNs = 200000;
+// Pause hints between two polls while spinning
+constexpr int kSpinPauses = 64;
+
+int64_t now_ns(clockid_t clock) {
+  timespec ts = {};
+  clock_gettime(clock, &ts);
+  return int64_t(ts.tv_sec) * 1000000000ll + ts.tv_nsec;
+}
+
+void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+const char* mode_name(DequeuePolicy::Mode mode) {
+  switch (mode) {
+    case DequeuePolicy::Mode::kBlock:
+      return "block";
+    case DequeuePolicy::Mode::kSpin:
+      return "spin";
+    case DequeuePolicy::Mode::kBusyPoll:
+      return "busy";
+  }
+  return "unknown";
+}
+
+}  // namespace
+
+DequeuePolicy::DequeuePolicy(Mode mode, const std::atomic<bool>* quit)
+    : m_mode(mode), m_quit(quit) {
+  Log(LogLevel::kInfo) << "DequeuePolicy " << mode_name(m_mode);
+}
+
+bool DequeuePolicy::ParseMode(const std::string& name, Mode* mode) {
+  for (Mode m : {Mode::kBlock, Mode::kSpin, Mode::kBusyPoll}) {
+    if (name == mode_name(m)) {
+      *mode = m;
+      return true;
+    }
+  }
+  return false;
+}
+
+void DequeuePolicy::SetFrameInterval(v4l2_fract timeperframe) {
+  if (timeperframe.denominator == 0) {
+    return;
+  }
+  m_interval_ns =
+      1000000000ll * timeperframe.numerator / timeperframe.denominator;
+}
+
+bool DequeuePolicy::Wait(int fd, short events) {
+  ScopedTrace trace("wait");
+  const int64_t cpu_start = now_ns(CLOCK_THREAD_CPUTIME_ID);
+  bool ready = false;
+  bool spun = false;
+  bool ok = true;
+
+  switch (m_mode) {
+    case Mode::kBlock:
+      break;
+    case Mode::kBusyPoll:
+      ok = Spin(fd, events, std::numeric_limits<int64_t>::max(), &ready);
+      spun = true;
+      break;
+    case Mode::kSpin:
+      if (m_interval_ns > 0 && m_last_ready_ns > 0) {
+        const int64_t window = std::max(kMinSpinWindowNs, m_interval_ns / 8);
+        const int64_t expected = m_last_ready_ns + m_interval_ns;
+
+        // Sleep until the spin window opens; an early frame wakes us up
+        const int64_t now = now_ns(CLOCK_MONOTONIC);
+        if (now < expected - window) {
+          ok = Poll(fd, events, expected - window - now, &ready);
+        }
+        if (ok && !ready) {
+          ok = Spin(fd, events, expected + window, &ready);
+          spun = ready;
+        }
+      }
+      break;
+  }
+
+  // Block for frames that are late or when not spinning at all
+  if (ok && !ready) {
+    ok = Poll(fd, events, -1, &ready);
+  }
+
+  if (ok) {
+    if (spun) {
+      m_spin_wakeups++;
+    } else {
+      m_block_wakeups++;
+    }
+
+    // Track the frame interval, ignoring stalls
+    const int64_t ready_ns = now_ns(CLOCK_MONOTONIC);
+    if (m_last_ready_ns > 0) {
+      const int64_t delta = ready_ns - m_last_ready_ns;
+      if (m_interval_ns == 0) {
+        m_interval_ns = delta;
+      } else if (delta < 2 * m_interval_ns) {
+        m_interval_ns += (delta - m_interval_ns) / 8;
+      }
+    }
+    m_last_ready_ns = ready_ns;
+  }
+
+  m_waits++;
+  m_cpu_ns += now_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+  return ok;
+}
+
+void DequeuePolicy::RecordLatency(uint64_t timestamp_us) {
+  const int64_t now_us = now_ns(CLOCK_MONOTONIC) / 1000;
+  if (timestamp_us == 0 || int64_t(timestamp_us) > now_us) {
+    return;
+  }
+
+  const int64_t latency_us = now_us - int64_t(timestamp_us);
+  m_latency_samples++;
+  m_latency_total_us += latency_us;
+  m_latency_max_us = std::max(m_latency_max_us, latency_us);
+}
+
+void DequeuePolicy::Report() const {
+  LogMessage message(LogLevel::kInfo);
+  message << "Dequeue " << mode_name(m_mode) << ": waits " << m_waits
+          << ", spin wakeups " << m_spin_wakeups << ", block wakeups "
+          << m_block_wakeups << ", cpu " << m_cpu_ns / 1000000 << " ms";
+  if (m_waits) {
+    message << " (" << m_cpu_ns / 1000 / int64_t(m_waits) << " us/wait)";
+  }
+  if (m_latency_samples) {
+    message << ", latency avg "
+            << m_latency_total_us / int64_t(m_latency_samples) << " us max "
+            << m_latency_max_us << " us";
+  }
+  message << ", interval " << m_interval_ns / 1000 << " us";
+}
+
+bool DequeuePolicy::Poll(int fd,
+                         short events,
+                         int64_t timeout_ns,
+                         bool* ready) {
+  pollfd pfd = {};
+  pfd.fd = fd;
+  pfd.events = events;
+
+  timespec timeout = {};
+  timeout.tv_sec = timeout_ns / 1000000000ll;
+  timeout.tv_nsec = timeout_ns % 1000000000ll;
+
+  // Other signals, e.g. SIGUSR1 toggling the trace, only restart the poll
+  int ret;
+  do {
+    if (m_quit->load(std::memory_order_relaxed)) {
+      return false;
+    }
+    ret = ppoll(&pfd, 1, timeout_ns < 0 ? nullptr : &timeout, nullptr);
+  } while (ret < 0 && errno == EINTR);
+  if (ret < 0) {
+    Log(LogLevel::kError) << "poll failed";
+    return false;
+  }
+
+  // Errors count as ready so that DQBUF reports them
+  *ready = ret > 0;
+  return true;
+}
+
+bool DequeuePolicy::Spin(int fd,
+                         short events,
+                         int64_t deadline_ns,
+                         bool* ready) {
+  // Poll() checks the quit flag, so busy polling without a deadline still
+  // stops
+  while (true) {
+    if (!Poll(fd, events, 0, ready)) {
+      return false;
+    }
+    if (*ready || now_ns(CLOCK_MONOTONIC) >= deadline_ns) {
+      return true;
+    }
+    for (int i = 0; i < kSpinPauses; i++) {
+      cpu_relax();
+    }
+  }
+}
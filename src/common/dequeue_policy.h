@@ -0,0 +1,96 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __DEQUEUE_POLICY_H__
+#define __DEQUEUE_POLICY_H__
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <linux/videodev2.h>
+
+// Decides how a loop waits for a V4L2 fd to become ready before DQBUF.
+//
+// kBlock sleeps in poll() until the driver wakes it up.
+// kSpin sleeps until shortly before the next frame is due, spins with a CPU
+// pause hint across the expected arrival, and blocks if the frame is late.
+// The expected arrival is tracked from the measured frame interval.
+// kBusyPoll never sleeps and keeps a CPU core busy for the lowest latency.
+//
+// Wait() gives up when the quit flag is set, so a spinning loop still stops
+// on SIGINT. It accounts the thread CPU time it burns. RecordLatency()
+// accounts the time from the driver timestamp of a frame to its dequeue, so
+// the modes can be compared per camera with Report().
+class DequeuePolicy {
+ public:
+  enum class Mode { kBlock, kSpin, kBusyPoll };
+
+  // `quit` is checked on every spin iteration and poll, e.g. the flag set
+  // by the SIGINT handler
+  DequeuePolicy(Mode mode, const std::atomic<bool>* quit);
+
+  // Parses "block", "spin" or "busy"
+  static bool ParseMode(const std::string& name, Mode* mode);
+
+  // Seeds the frame interval estimate, e.g. from VIDIOC_G_PARM
+  void SetFrameInterval(v4l2_fract timeperframe);
+
+  // Waits until `fd` reports `events`. Returns false if polling failed or
+  // the quit flag is set.
+  bool Wait(int fd, short events);
+
+  // Records the wakeup latency of a frame with a CLOCK_MONOTONIC driver
+  // timestamp in microseconds; zero timestamps are ignored.
+  void RecordLatency(uint64_t timestamp_us);
+
+  void Report() const;
+
+ private:
+  bool Poll(int fd, short events, int64_t timeout_ns, bool* ready);
+  bool Spin(int fd, short events, int64_t deadline_ns, bool* ready);
+
+  Mode m_mode;
+  const std::atomic<bool>* m_quit;
+
+  // Frame interval estimate and the time the last frame became ready
+  int64_t m_interval_ns = 0;
+  int64_t m_last_ready_ns = 0;
+
+  uint64_t m_waits = 0;
+  uint64_t m_spin_wakeups = 0;
+  uint64_t m_block_wakeups = 0;
+  int64_t m_cpu_ns = 0;
+
+  uint64_t m_latency_samples = 0;
+  int64_t m_latency_total_us = 0;
+  int64_t m_latency_max_us = 0;
+};
+#endif /* __DEQUEUE_POLICY_H__ */
@@ -37,22 +37,23 @@
 
 #include "check.h"
 #include "drm_prime_dmabuf.h"
+#include "logger.h"
 
 int DrmPrimeDmabuf::OpenDrm(const char* dev_path) {
   int fd = open(dev_path, O_RDWR);
   if (fd < 0) {
-    std::cout << "Unable to open drm device " << dev_path << std::endl;
+    Log(LogLevel::kError) << "Unable to open drm device " << dev_path;
     CHECK(0);
   }
 
   drmVersion* version = drmGetVersion(fd);
   if (!version) {
-    std::cout << "drmGetVersion failed\n";
+    Log(LogLevel::kError) << "drmGetVersion failed";
     CHECK(0);
   }
 
-  std::cout << dev_path << ": name " << version->name << ", desc "
-            << version->desc << std::endl;
+  Log(LogLevel::kInfo) << dev_path << ": name " << version->name << ", desc "
+                       << version->desc;
 
   drmFreeVersion(version);
 
@@ -72,8 +73,8 @@ DrmPrimeDmabuf::DrmPrimeDmabuf(int drm_fd, int size) {
   gem_create.size = m_size;
   ret = drmIoctl(m_drm_fd, DRM_IOCTL_I915_GEM_CREATE, &gem_create);
   if (ret) {
-    std::cout << "DRM_IOCTL_I915_GEM_CREATE failed: size " << gem_create.size
-              << std::endl;
+    Log(LogLevel::kError) << "DRM_IOCTL_I915_GEM_CREATE failed: size "
+                          << gem_create.size;
     CHECK(0);
   }
 
@@ -82,14 +83,14 @@ DrmPrimeDmabuf::DrmPrimeDmabuf(int drm_fd, int size) {
   gem_set_tiling.tiling_mode = I915_TILING_NONE;
   ret = drmIoctl(m_drm_fd, DRM_IOCTL_I915_GEM_SET_TILING, &gem_set_tiling);
   if (ret) {
-    std::cout << "DRM_IOCTL_I915_GEM_SET_TILING failed\n";
+    Log(LogLevel::kError) << "DRM_IOCTL_I915_GEM_SET_TILING failed";
     CHECK(0);
   }
 
   ret = drmPrimeHandleToFD(m_drm_fd, gem_create.handle, DRM_CLOEXEC | DRM_RDWR,
                            &m_fd);
   if (ret != 0) {
-    std::cout << "drmPrimeHandleToFD failed\n";
+    Log(LogLevel::kError) << "drmPrimeHandleToFD failed";
     CHECK(0);
   }
 
@@ -100,9 +101,9 @@ void* DrmPrimeDmabuf::Map(uint32_t size) {
   CHECK(m_size >= size);
 
   m_mapped_addr = mmap(0, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
-
-  CHECK(m_mapped_addr != nullptr);
-  CHECK(m_mapped_addr != MAP_FAILED);
+  if (m_mapped_addr == MAP_FAILED) {
+    m_mapped_addr = nullptr;
+  }
 
   return m_mapped_addr;
 }
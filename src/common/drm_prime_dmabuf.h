@@ -39,6 +39,7 @@ class DrmPrimeDmabuf {
 
   DrmPrimeDmabuf(int drm_fd, int size);
 
+  // Returns nullptr with errno set if the buffer cannot be mapped
   void* Map(uint32_t size);
   void Unmap(void* addr);
 
@@ -0,0 +1,99 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "check.h"
+#include "frame_pacer.h"
+#include "logger.h"
+
+FramePacer::FramePacer(v4l2_fract timeperframe)
+    : m_timeperframe(timeperframe) {
+  CHECK(m_timeperframe.numerator > 0);
+  CHECK(m_timeperframe.denominator > 0);
+
+  m_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (m_fd < 0) {
+    Log(LogLevel::kError) << "timerfd_create failed";
+    CHECK(0);
+  }
+
+  Log(LogLevel::kInfo) << "FramePacer fps "
+                       << float(m_timeperframe.denominator) /
+                              m_timeperframe.numerator;
+}
+
+FramePacer::~FramePacer() {
+  if (m_fd >= 0) {
+    close(m_fd);
+    m_fd = -1;
+  }
+}
+
+void FramePacer::Start() {
+  const uint64_t period_ns =
+      1000000000ull * m_timeperframe.numerator / m_timeperframe.denominator;
+
+  itimerspec spec = {};
+  spec.it_interval.tv_sec = period_ns / 1000000000ull;
+  spec.it_interval.tv_nsec = period_ns % 1000000000ull;
+  spec.it_value = spec.it_interval;
+
+  if (timerfd_settime(m_fd, 0, &spec, nullptr) < 0) {
+    Log(LogLevel::kError) << "timerfd_settime failed";
+    CHECK(0);
+  }
+}
+
+uint64_t FramePacer::Tick() {
+  uint64_t expirations = 0;
+  if (read(m_fd, &expirations, sizeof(expirations)) !=
+      sizeof(expirations)) {
+    CHECK(errno == EAGAIN || errno == EINTR);
+    return 0;
+  }
+
+  if (expirations > 1) {
+    m_late_ticks += expirations - 1;
+  }
+  return expirations;
+}
+
+void FramePacer::OnSend() {
+  if (m_pending_frames == 0) {
+    m_duplicated_frames++;
+  } else {
+    m_dropped_frames += m_pending_frames - 1;
+  }
+  m_pending_frames = 0;
+}
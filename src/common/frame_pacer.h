@@ -0,0 +1,77 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __FRAME_PACER_H__
+#define __FRAME_PACER_H__
+
+#include <cstdint>
+
+#include <linux/videodev2.h>
+
+// Releases output frames on a steady timerfd cadence. The caller polls
+// GetFd() alongside the capture device and sends the newest frame on every
+// tick, so capture jitter is absorbed at the cost of at most one frame
+// interval of added latency. A tick without a new frame repeats the last
+// one; several frames arriving between ticks leave only the newest.
+class FramePacer {
+ public:
+  explicit FramePacer(v4l2_fract timeperframe);
+  ~FramePacer();
+
+  void Start();
+
+  int GetFd() const { return m_fd; }
+
+  // Consumes the pending timer expirations. Returns the number of ticks
+  // elapsed since the last call; ticks missed beyond the first are counted
+  // as late.
+  uint64_t Tick();
+
+  // Records that a frame arrived from the capture side.
+  void OnFrame() { m_pending_frames++; }
+
+  // Records that the current tick sent a frame downstream.
+  void OnSend();
+
+  uint64_t GetDuplicatedFrames() const { return m_duplicated_frames; }
+  uint64_t GetDroppedFrames() const { return m_dropped_frames; }
+  uint64_t GetLateTicks() const { return m_late_ticks; }
+
+ private:
+  int m_fd = -1;
+  v4l2_fract m_timeperframe;
+
+  uint64_t m_pending_frames = 0;
+
+  uint64_t m_duplicated_frames = 0;
+  uint64_t m_dropped_frames = 0;
+  uint64_t m_late_ticks = 0;
+};
+#endif /* __FRAME_PACER_H__ */
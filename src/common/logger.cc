@@ -0,0 +1,256 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <signal.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "check.h"
+#include "logger.h"
+
+namespace {
+
+// 1024 lines of up to a LogMessage each, about 260 KB
+constexpr uint64_t kSlotCount = 1024;
+constexpr size_t kSlotSize = LogMessage::kMaxLength;
+
+// A slot is free for the producer claiming position `p` when its sequence
+// is `p`, and holds a line for the writer when it is `p + 1`
+struct LogSlot {
+  std::atomic<uint64_t> sequence;
+  LogLevel level;
+  uint32_t len;
+  char text[kSlotSize];
+};
+
+LogSlot g_slots[kSlotCount];
+std::atomic<uint64_t> g_head{0};
+std::atomic<uint64_t> g_written{0};
+std::atomic<uint64_t> g_dropped{0};
+std::atomic<bool> g_running{false};
+
+const char* level_prefix(LogLevel level) {
+  switch (level) {
+    case LogLevel::kWarning:
+      return "Warning: ";
+    case LogLevel::kError:
+      return "Error: ";
+    default:
+      return "";
+  }
+}
+
+void write_line(LogLevel level, std::string_view text) {
+  fputs(level_prefix(level), stdout);
+  fwrite(text.data(), 1, text.size(), stdout);
+  fputc('\n', stdout);
+}
+
+int64_t now_ns() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+}  // namespace
+
+std::atomic<int> Logger::s_level{int(LogLevel::kInfo)};
+
+void Logger::Initialize(LogLevel level) {
+  s_level = int(level);
+  if (g_running.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  // The slots are seeded before g_running publishes them to producers
+  for (uint64_t i = 0; i < kSlotCount; i++) {
+    g_slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  // Queued lines would be lost on abort
+  g_check_failed_hook = Flush;
+  g_running.store(true, std::memory_order_release);
+  std::thread(Run).detach();
+}
+
+bool Logger::ParseLevel(const std::string& name, LogLevel* level) {
+  if (name == "debug") {
+    *level = LogLevel::kDebug;
+  } else if (name == "info") {
+    *level = LogLevel::kInfo;
+  } else if (name == "warning") {
+    *level = LogLevel::kWarning;
+  } else if (name == "error") {
+    *level = LogLevel::kError;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void Logger::Write(LogLevel level, std::string_view text) {
+  if (!g_running.load(std::memory_order_acquire)) {
+    write_line(level, text);
+    fflush(stdout);
+    return;
+  }
+
+  // Claim a free slot, or drop the line if the writer is a full ring behind
+  uint64_t pos = g_head.load(std::memory_order_relaxed);
+  LogSlot* slot;
+  for (;;) {
+    slot = &g_slots[pos % kSlotCount];
+    const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    const int64_t diff = int64_t(sequence) - int64_t(pos);
+    if (diff == 0) {
+      if (g_head.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      g_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      pos = g_head.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->level = level;
+  slot->len = std::min(text.size(), kSlotSize);
+  memcpy(slot->text, text.data(), slot->len);
+  slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+void Logger::Run() {
+  // Leave signals such as SIGINT to the application threads
+  sigset_t mask;
+  sigfillset(&mask);
+  pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+  uint64_t tail = 0;
+  uint64_t reported_dropped = 0;
+  for (;;) {
+    // Drain everything ready, then flush once
+    uint32_t lines = 0;
+    for (;;) {
+      LogSlot& slot = g_slots[tail % kSlotCount];
+      if (slot.sequence.load(std::memory_order_acquire) != tail + 1) {
+        break;
+      }
+      write_line(slot.level, std::string_view(slot.text, slot.len));
+      slot.sequence.store(tail + kSlotCount, std::memory_order_release);
+      tail++;
+      lines++;
+    }
+
+    const uint64_t dropped = g_dropped.load(std::memory_order_relaxed);
+    if (dropped != reported_dropped) {
+      fprintf(stdout, "Warning: %llu log lines dropped\n",
+              (unsigned long long)(dropped - reported_dropped));
+      reported_dropped = dropped;
+      lines++;
+    }
+
+    if (lines) {
+      fflush(stdout);
+      g_written.store(tail, std::memory_order_release);
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+void Logger::Flush() {
+  if (!g_running.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  // Lines claimed but still being copied in are waited for as well
+  const uint64_t head = g_head.load(std::memory_order_acquire);
+  while (g_written.load(std::memory_order_acquire) < head) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+bool LogRateLimiter::Allow(uint64_t* suppressed) {
+  const int64_t now = now_ns();
+  int64_t start = m_window_start_ns.load(std::memory_order_relaxed);
+  if (now - start >= 1000000000 &&
+      m_window_start_ns.compare_exchange_strong(start, now,
+                                                std::memory_order_relaxed)) {
+    m_count.store(0, std::memory_order_relaxed);
+  }
+
+  if (m_count.fetch_add(1, std::memory_order_relaxed) >= m_per_second) {
+    m_suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  *suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+  return true;
+}
+
+LogMessage::LogMessage(LogLevel level, LogRateLimiter* limiter)
+    : m_level(level),
+      m_enabled(Logger::IsEnabled(level) &&
+                (!limiter || limiter->Allow(&m_suppressed))) {}
+
+LogMessage::~LogMessage() {
+  if (!m_enabled) {
+    return;
+  }
+  if (m_suppressed) {
+    *this << " (" << m_suppressed << " more suppressed)";
+  }
+  Logger::Write(m_level, std::string_view(m_text, m_len));
+}
+
+LogMessage& LogMessage::operator<<(std::string_view text) {
+  if (m_enabled) {
+    const size_t len = std::min(text.size(), kMaxLength - m_len);
+    memcpy(m_text + m_len, text.data(), len);
+    m_len += len;
+  }
+  return *this;
+}
+
+LogMessage& LogMessage::operator<<(double value) {
+  if (m_enabled) {
+    // Same 6 significant digits as std::cout
+    m_len = std::to_chars(m_text + m_len, m_text + kMaxLength, value,
+                          std::chars_format::general, 6)
+                .ptr -
+            m_text;
+  }
+  return *this;
+}
@@ -0,0 +1,142 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __LOGGER_H__
+#define __LOGGER_H__
+
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+enum class LogLevel { kDebug, kInfo, kWarning, kError };
+
+// Asynchronous logger that keeps console output off the frame path.
+//
+// Producers format a line on their own stack and push it into a bounded
+// lock-free MPSC ring; a writer thread drains the ring to stdout. A full
+// ring drops the line and counts it rather than blocking, so a slow
+// terminal or journald never stalls the capture thread. Before
+// Initialize() lines are written synchronously.
+class Logger {
+ public:
+  // Starts the writer thread and shows lines of `level` and above. Call
+  // from the main thread before other threads start.
+  static void Initialize(LogLevel level);
+
+  // Parses "debug", "info", "warning" or "error"
+  static bool ParseLevel(const std::string& name, LogLevel* level);
+
+  static bool IsEnabled(LogLevel level) {
+    return int(level) >= s_level.load(std::memory_order_relaxed);
+  }
+
+  // Queues one line without the trailing newline
+  static void Write(LogLevel level, std::string_view text);
+
+  // Waits until every line queued so far is written, e.g. before printing
+  // reports with std::cout
+  static void Flush();
+
+ private:
+  static void Run();
+
+  static std::atomic<int> s_level;
+};
+
+// Lets at most `per_second` lines a second through from one call site, e.g.
+// an error that can repeat every frame. Lines held back are counted and
+// reported with the next line let through.
+class LogRateLimiter {
+ public:
+  explicit LogRateLimiter(uint32_t per_second) : m_per_second(per_second) {}
+
+  // Returns true if a line may be logged now, with the number of lines held
+  // back since the last one in `suppressed`
+  bool Allow(uint64_t* suppressed);
+
+ private:
+  const uint32_t m_per_second;
+  std::atomic<int64_t> m_window_start_ns{0};
+  std::atomic<uint32_t> m_count{0};
+  std::atomic<uint64_t> m_suppressed{0};
+};
+
+// One log line, formatted into a fixed buffer and queued when destroyed:
+//   Log(LogLevel::kInfo) << "Frames " << frames;
+// Lines longer than the buffer are truncated.
+class LogMessage {
+ public:
+  static constexpr size_t kMaxLength = 240;
+
+  explicit LogMessage(LogLevel level, LogRateLimiter* limiter = nullptr);
+  ~LogMessage();
+
+  LogMessage(const LogMessage&) = delete;
+  LogMessage& operator=(const LogMessage&) = delete;
+
+  LogMessage& operator<<(std::string_view text);
+  LogMessage& operator<<(const char* text) {
+    return *this << std::string_view(text);
+  }
+  LogMessage& operator<<(const std::string& text) {
+    return *this << std::string_view(text);
+  }
+  LogMessage& operator<<(char c) { return *this << std::string_view(&c, 1); }
+  LogMessage& operator<<(bool value) { return *this << int(value); }
+  LogMessage& operator<<(double value);
+
+  template <typename T,
+            typename = std::enable_if_t<std::is_integral_v<T> &&
+                                        !std::is_same_v<T, bool> &&
+                                        !std::is_same_v<T, char>>>
+  LogMessage& operator<<(T value) {
+    if (m_enabled) {
+      m_len = std::to_chars(m_text + m_len, m_text + kMaxLength, value).ptr -
+              m_text;
+    }
+    return *this;
+  }
+
+ private:
+  // Set by the limiter before m_enabled is initialized
+  uint64_t m_suppressed = 0;
+  LogLevel m_level;
+  bool m_enabled;
+  size_t m_len = 0;
+  char m_text[kMaxLength];
+};
+
+inline LogMessage Log(LogLevel level, LogRateLimiter* limiter = nullptr) {
+  return LogMessage(level, limiter);
+}
+#endif /* __LOGGER_H__ */
@@ -0,0 +1,269 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "check.h"
+#include "logger.h"
+#include "m2m_encoder.h"
+#include "trace.h"
+#include "v4l2_device_info.h"
+#include "v4l2_utils.h"
+
+namespace {
+
+// Frames waiting for the encoder before new ones are dropped
+constexpr size_t kMaxPending = 2;
+
+// A coded frame is dequeued before the next raw frame is queued, so a few
+// buffers are enough
+constexpr int kCodedBufferCount = 4;
+
+}  // namespace
+
+M2MEncoder::M2MEncoder(int fd, uint32_t coded_format)
+    : m_fd(fd), m_coded_format(coded_format) {}
+
+M2MEncoder::~M2MEncoder() {
+  Stop();
+
+  m_raw_import.reset();
+  m_raw_copy.reset();
+  m_coded.reset();
+  if (m_file) {
+    fclose(m_file);
+    m_file = nullptr;
+  }
+  close(m_fd);
+}
+
+bool M2MEncoder::Initialize(const v4l2_pix_format& raw_format,
+                            int buffer_count,
+                            bool import,
+                            const std::string& record_path) {
+  V4L2DeviceInfo info;
+  if (!v4l2_query_capability(m_fd, &info)) {
+    return false;
+  }
+  if (!(info.capabilities & V4L2_CAP_VIDEO_M2M)) {
+    std::cout << "Not a single-planar mem2mem device: " << info.card
+              << std::endl;
+    return false;
+  }
+
+  // A stateful encoder takes the coded format first, then the raw format
+  v4l2_pix_format coded_format = {};
+  coded_format.pixelformat = m_coded_format;
+  coded_format.width = raw_format.width;
+  coded_format.height = raw_format.height;
+  if (!v4l2_set_pix_format(m_fd, V4L2_BUF_TYPE_VIDEO_CAPTURE,
+                           &coded_format)) {
+    return false;
+  }
+  v4l2_pix_format pix_format = raw_format;
+  if (!v4l2_set_pix_format(m_fd, V4L2_BUF_TYPE_VIDEO_OUTPUT, &pix_format)) {
+    return false;
+  }
+  // Frames are copied or imported as they are, so the encoder must take
+  // the capture layout unchanged
+  if (pix_format.pixelformat != raw_format.pixelformat ||
+      pix_format.width != raw_format.width ||
+      pix_format.height != raw_format.height ||
+      pix_format.bytesperline != raw_format.bytesperline ||
+      pix_format.sizeimage != raw_format.sizeimage) {
+    std::cout << "Encoder raw format " << pix_format.width << "x"
+              << pix_format.height << ", stride " << pix_format.bytesperline
+              << ", size " << pix_format.sizeimage
+              << " does not match the capture format" << std::endl;
+    return false;
+  }
+  m_raw_size = pix_format.sizeimage;
+
+  if (!record_path.empty()) {
+    m_file = fopen(record_path.c_str(), "wb");
+    if (!m_file) {
+      std::cout << "Could not open recording " << record_path << std::endl;
+      return false;
+    }
+  }
+
+  V4L2Device* raw;
+  if (import) {
+    m_raw_import = std::make_unique<RawImportDevice>(m_fd, raw_format.width,
+                                                     raw_format.height);
+    raw = m_raw_import.get();
+  } else {
+    m_raw_copy = std::make_unique<RawCopyDevice>(m_fd, raw_format.width,
+                                                 raw_format.height);
+    raw = m_raw_copy.get();
+  }
+  m_coded = std::make_unique<CaptureDeviceMmap>(m_fd, raw_format.width,
+                                                raw_format.height);
+  raw->Initialize(buffer_count);
+  m_coded->Initialize(kCodedBufferCount);
+  raw->Start();
+  m_coded->Start();
+  if (raw->IsLost() || m_coded->IsLost()) {
+    std::cout << "Encoder device lost" << std::endl;
+    return false;
+  }
+  if (m_raw_copy) {
+    m_raw_free = m_raw_copy->GetBuffer(0);
+  }
+
+  std::cout << "Encoder " << info.card << ": "
+            << v4l2_fourcc_to_string(pix_format.pixelformat) << " to "
+            << v4l2_fourcc_to_string(m_coded_format) << ", "
+            << (import ? "dmabuf import" : "copy") << std::endl;
+
+  m_thread = std::thread(&M2MEncoder::Run, this);
+  return true;
+}
+
+void M2MEncoder::Encode(BufferLease frame) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_failed || m_stop || m_pending.size() >= kMaxPending) {
+    m_dropped++;
+    return;
+  }
+  m_pending.push_back(std::move(frame));
+  m_cv.notify_all();
+}
+
+void M2MEncoder::Drain() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cv.wait(lock, [this]() { return m_pending.empty() && !m_busy; });
+}
+
+void M2MEncoder::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+    m_cv.notify_all();
+  }
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+}
+
+void M2MEncoder::Report() const {
+  std::cout << "Encoder " << v4l2_fourcc_to_string(m_coded_format)
+            << ": frames " << m_frames << ", dropped " << m_dropped
+            << ", coded " << m_coded_bytes / 1024 << " KB";
+  if (m_coded_bytes) {
+    std::cout << " (" << m_raw_size * m_frames / m_coded_bytes << ":1)";
+  }
+  if (m_frames) {
+    std::cout << ", " << m_encode_ns / 1000 / int64_t(m_frames)
+              << " us/frame";
+  }
+  std::cout << std::endl;
+}
+
+void M2MEncoder::Run() {
+  Trace::SetThreadName("encode");
+
+  while (true) {
+    BufferLease frame;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this]() { return m_stop || !m_pending.empty(); });
+      if (m_pending.empty()) {
+        break;
+      }
+      frame = std::move(m_pending.front());
+      m_pending.pop_front();
+      m_busy = true;
+    }
+
+    if (!m_failed) {
+      EncodeFrame(std::move(frame));
+    }
+    frame.Reset();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_busy = false;
+    m_cv.notify_all();
+  }
+}
+
+void M2MEncoder::EncodeFrame(BufferLease frame) {
+  ScopedTrace trace("encode", frame->sequence);
+  const auto start = std::chrono::steady_clock::now();
+
+  // Queue the raw frame, returning a copied one at once
+  V4L2Device* raw;
+  if (m_raw_import) {
+    V4L2DeviceBuffer raw_buffer = *frame;
+    raw_buffer.index %= m_raw_import->GetBufferCount();
+    raw_buffer.len = m_raw_size;
+    m_raw_import->Queue(raw_buffer);
+    raw = m_raw_import.get();
+  } else {
+    CHECK(frame->len >= m_raw_size);
+    memcpy(m_raw_free.data, frame->data, m_raw_size);
+    m_raw_free.len = m_raw_size;
+    m_raw_free.timestamp_us = frame->timestamp_us;
+    m_raw_copy->Queue(m_raw_free);
+    frame.Reset();
+    raw = m_raw_copy.get();
+  }
+
+  BufferLease coded = m_coded->Lease();
+  if (coded) {
+    if (m_file) {
+      fwrite(coded->data, 1, coded->bytesused, m_file);
+    }
+    m_coded_bytes += coded->bytesused;
+    coded.Reset();
+  }
+
+  // Take the raw buffer back once the encoder has read it
+  const V4L2DeviceBuffer consumed = raw->Dequeue();
+  if (m_raw_copy) {
+    m_raw_free = consumed;
+  }
+
+  if (raw->IsLost() || m_coded->IsLost()) {
+    Log(LogLevel::kError) << "Encoder device lost, encoding stopped";
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_failed = true;
+    return;
+  }
+
+  m_frames++;
+  m_encode_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+}
@@ -0,0 +1,111 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __M2M_ENCODER_H__
+#define __M2M_ENCODER_H__
+
+#include <linux/videodev2.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "v4l2_device.h"
+#include "v4l2_stream_device.h"
+
+// Stateful V4L2 mem2mem encoder, such as the kernel's vicodec FWHT codec,
+// run on its own thread. Raw frames go in on the OUTPUT queue and coded
+// frames come out of the CAPTURE queue, appended to a recording file.
+class M2MEncoder {
+ public:
+  // Takes ownership of `fd`, an opened encoder node
+  M2MEncoder(int fd, uint32_t coded_format);
+  ~M2MEncoder();
+
+  // Sets the formats and starts both queues and the encode thread. With
+  // `import`, frames are queued by their dmabuf fd without a copy and must
+  // carry one; otherwise they are copied into the encoder's buffers.
+  bool Initialize(const v4l2_pix_format& raw_format,
+                  int buffer_count,
+                  bool import,
+                  const std::string& record_path);
+
+  // Hands a frame to the encode thread, which returns its buffer once the
+  // frame was read. The frame is dropped while the encoder is behind.
+  void Encode(BufferLease frame);
+
+  // Blocks until every frame handed over was encoded and returned. Call
+  // before the frames' device is released.
+  void Drain();
+
+  // Drains and joins the encode thread
+  void Stop();
+
+  void Report() const;
+
+ private:
+  using RawImportDevice = V4L2StreamDevice<M2MOutputDirection, ImportMemory>;
+  using RawCopyDevice = V4L2StreamDevice<M2MOutputDirection, MmapMemory>;
+
+  void Run();
+  void EncodeFrame(BufferLease frame);
+
+  int m_fd;
+  uint32_t m_coded_format;
+  uint32_t m_raw_size = 0;
+
+  std::unique_ptr<RawImportDevice> m_raw_import;
+  std::unique_ptr<RawCopyDevice> m_raw_copy;
+  std::unique_ptr<V4L2Device> m_coded;
+
+  // Raw buffer owned by this side in copy mode
+  V4L2DeviceBuffer m_raw_free = {};
+
+  FILE* m_file = nullptr;
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<BufferLease> m_pending;
+  bool m_busy = false;
+  bool m_stop = false;
+  bool m_failed = false;
+
+  uint64_t m_frames = 0;
+  uint64_t m_dropped = 0;
+  uint64_t m_coded_bytes = 0;
+  int64_t m_encode_ns = 0;
+};
+#endif /* __M2M_ENCODER_H__ */
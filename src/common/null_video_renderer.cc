@@ -0,0 +1,58 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "null_video_renderer.h"
+
+void NullVideoRenderer::RenderFrameI420(uint32_t width,
+                                        uint32_t height,
+                                        const uint8_t* y_data,
+                                        uint32_t y_pitch,
+                                        const uint8_t* u_data,
+                                        uint32_t u_pitch,
+                                        const uint8_t* v_data,
+                                        uint32_t v_pitch) {
+  m_stats.frames++;
+}
+
+void NullVideoRenderer::RenderFrameNV12(uint32_t width,
+                                        uint32_t height,
+                                        const uint8_t* y_data,
+                                        int y_stride,
+                                        const uint8_t* uv_data,
+                                        int uv_stride) {
+  m_stats.frames++;
+}
+
+void NullVideoRenderer::RenderFrameYUY2(uint32_t width,
+                                        uint32_t height,
+                                        const uint8_t* data,
+                                        uint32_t stride) {
+  m_stats.frames++;
+}
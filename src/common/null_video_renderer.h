@@ -0,0 +1,69 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __NULL_VIDEO_RENDERER_H__
+#define __NULL_VIDEO_RENDERER_H__
+
+#include "video_renderer.h"
+
+// Drops every frame without converting it and only counts frames, as the
+// baseline for the cost of the other backends.
+class NullVideoRenderer : public VideoRenderer {
+ public:
+  NullVideoRenderer() = default;
+  ~NullVideoRenderer() override = default;
+
+  std::string GetDriverName() const override { return "null"; }
+
+  void RenderFrameI420(uint32_t width,
+                       uint32_t height,
+                       const uint8_t* y_data,
+                       uint32_t y_pitch,
+                       const uint8_t* u_data,
+                       uint32_t u_pitch,
+                       const uint8_t* v_data,
+                       uint32_t v_pitch) override;
+
+  void RenderFrameNV12(uint32_t width,
+                       uint32_t height,
+                       const uint8_t* y_data,
+                       int y_stride,
+                       const uint8_t* uv_data,
+                       int uv_stride) override;
+
+  void RenderFrameYUY2(uint32_t width,
+                       uint32_t height,
+                       const uint8_t* data,
+                       uint32_t stride) override;
+
+ protected:
+  bool GetOutputSize(int* width, int* height) override { return false; }
+};
+#endif /* __NULL_VIDEO_RENDERER_H__ */
@@ -0,0 +1,304 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#include <linux/videodev2.h>
+
+#include "check.h"
+#include "pattern_generator.h"
+
+namespace {
+
+// Sine lookup table resolution, one full period
+constexpr uint32_t kPhases = 1024;
+// Phase advance per frame, about 0.6 radians as in sdl2_renderer
+constexpr uint32_t kPhasePerFrame = 98;
+
+// Stripe of 128 blocks encoding the frame counter and the timestamp
+constexpr uint32_t kStripeBits = 128;
+constexpr uint32_t kStripeRows = 8;
+constexpr uint8_t kBlack = 16;
+constexpr uint8_t kWhite = 235;
+
+// 3x5 digit glyphs, row-major from the top left bit
+constexpr uint16_t kDigits[10] = {
+    0b111101101101111, 0b010110010010111, 0b111001111100111,
+    0b111001111001111, 0b101101111001001, 0b111100111001111,
+    0b111100111101111, 0b111001001001001, 0b111101111101111,
+    0b111101111001111,
+};
+
+// dst = src | pattern, with the 32-bit pattern repeated along the row from
+// its first byte. `n` need not be a multiple of 4.
+void or_row(uint8_t* dst, const uint8_t* src, size_t n, uint32_t pattern) {
+  size_t i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  const __m128i mask = _mm_set1_epi32(int(pattern));
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_or_si128(v, mask));
+  }
+#endif
+  for (; i < n; i++) {
+    dst[i] = src[i] | uint8_t(pattern >> (8 * (i % 4)));
+  }
+}
+
+uint8_t clamp_u8(int value) {
+  return uint8_t(std::clamp(value, 0, 255));
+}
+
+}  // namespace
+
+PatternGenerator::PatternGenerator(uint32_t pixelformat,
+                                   uint32_t width,
+                                   uint32_t height,
+                                   uint32_t bytesperline)
+    : m_pixelformat(pixelformat),
+      m_width(width),
+      m_height(height),
+      m_bytesperline(bytesperline),
+      m_luma_step(pixelformat == V4L2_PIX_FMT_YUYV ? 2 : 1) {
+  CHECK(IsSupported(pixelformat));
+  CHECK(width >= kStripeBits * 2 && width % 2 == 0 && height % 2 == 0);
+  CHECK(bytesperline >= GetBytesPerLine(pixelformat, width));
+
+  m_wave_y.resize(kPhases);
+  m_wave_c.resize(kPhases);
+  for (uint32_t p = 0; p < kPhases; p++) {
+    const double s = std::sin(2.0 * M_PI * p / kPhases);
+    m_wave_y[p] = int16_t(std::lround(s * 0.2 * 255));
+    m_wave_c[p] = int16_t(std::lround(s * 0.3 * 255));
+  }
+
+  // Luma: horizontal gradient with two wave periods across the width
+  m_grad_y.resize(width);
+  m_phase_y.resize(width);
+  for (uint32_t x = 0; x < width; x++) {
+    m_grad_y[x] = x * 255 / width;
+    m_phase_y[x] = (x * 2 * kPhases / width) % kPhases;
+  }
+
+  // Chroma: U varies down the frame as a cosine, V across it as a sine
+  const uint32_t chroma_width = width / 2;
+  const uint32_t chroma_height = height / 2;
+  m_grad_u.resize(chroma_height);
+  m_phase_u.resize(chroma_height);
+  for (uint32_t i = 0; i < chroma_height; i++) {
+    m_grad_u[i] = i * 255 / chroma_height;
+    m_phase_u[i] = (i * kPhases / chroma_height + kPhases / 4) % kPhases;
+  }
+  m_grad_v.resize(chroma_width);
+  m_phase_v.resize(chroma_width);
+  for (uint32_t j = 0; j < chroma_width; j++) {
+    m_grad_v[j] = j * 255 / chroma_width;
+    m_phase_v[j] = j * kPhases / chroma_width;
+  }
+
+  m_y_row.resize(width);
+  m_u_col.resize(chroma_height);
+  m_v_row.resize(chroma_width);
+  m_packed_row.resize(m_pixelformat == V4L2_PIX_FMT_YUYV ? width * 2 : width);
+}
+
+bool PatternGenerator::IsSupported(uint32_t pixelformat) {
+  return pixelformat == V4L2_PIX_FMT_YUYV ||
+         pixelformat == V4L2_PIX_FMT_NV12 ||
+         pixelformat == V4L2_PIX_FMT_YUV420;
+}
+
+uint32_t PatternGenerator::GetBytesPerLine(uint32_t pixelformat,
+                                           uint32_t width) {
+  return pixelformat == V4L2_PIX_FMT_YUYV ? width * 2 : width;
+}
+
+size_t PatternGenerator::GetFrameSize(uint32_t pixelformat,
+                                      uint32_t bytesperline,
+                                      uint32_t height) {
+  if (pixelformat == V4L2_PIX_FMT_YUYV) {
+    return size_t(bytesperline) * height;
+  }
+  return size_t(bytesperline) * height * 3 / 2;
+}
+
+void PatternGenerator::UpdateRows(uint64_t frame) {
+  const uint32_t t = (frame * kPhasePerFrame) % kPhases;
+
+  for (uint32_t x = 0; x < m_width; x++) {
+    m_y_row[x] =
+        clamp_u8(m_grad_y[x] + m_wave_y[(m_phase_y[x] + t) % kPhases]);
+  }
+  for (uint32_t i = 0; i < m_u_col.size(); i++) {
+    m_u_col[i] =
+        clamp_u8(m_grad_u[i] + m_wave_c[(m_phase_u[i] + t) % kPhases]);
+  }
+  for (uint32_t j = 0; j < m_v_row.size(); j++) {
+    m_v_row[j] = clamp_u8(
+        m_grad_v[j] + m_wave_c[(m_phase_v[j] + kPhases - t) % kPhases]);
+  }
+
+  // Interleaved rows with the U samples left zero, ORed in per row
+  if (m_pixelformat == V4L2_PIX_FMT_YUYV) {
+    for (uint32_t j = 0; j < m_v_row.size(); j++) {
+      m_packed_row[j * 4] = m_y_row[j * 2];
+      m_packed_row[j * 4 + 1] = 0;
+      m_packed_row[j * 4 + 2] = m_y_row[j * 2 + 1];
+      m_packed_row[j * 4 + 3] = m_v_row[j];
+    }
+  } else if (m_pixelformat == V4L2_PIX_FMT_NV12) {
+    for (uint32_t j = 0; j < m_v_row.size(); j++) {
+      m_packed_row[j * 2] = 0;
+      m_packed_row[j * 2 + 1] = m_v_row[j];
+    }
+  }
+}
+
+void PatternGenerator::Fill(uint8_t* data,
+                            size_t len,
+                            uint64_t frame,
+                            uint64_t timestamp_us) {
+  CHECK(len >= GetFrameSize(m_pixelformat, m_bytesperline, m_height));
+  UpdateRows(frame);
+
+  const uint32_t chroma_height = m_height / 2;
+  if (m_pixelformat == V4L2_PIX_FMT_YUYV) {
+    for (uint32_t y = 0; y < m_height; y++) {
+      or_row(data + size_t(y) * m_bytesperline, m_packed_row.data(),
+             m_packed_row.size(), uint32_t(m_u_col[y / 2]) << 8);
+    }
+  } else {
+    for (uint32_t y = 0; y < m_height; y++) {
+      memcpy(data + size_t(y) * m_bytesperline, m_y_row.data(), m_width);
+    }
+
+    uint8_t* chroma = data + size_t(m_bytesperline) * m_height;
+    if (m_pixelformat == V4L2_PIX_FMT_NV12) {
+      for (uint32_t i = 0; i < chroma_height; i++) {
+        const uint32_t u = m_u_col[i];
+        or_row(chroma + size_t(i) * m_bytesperline, m_packed_row.data(),
+               m_packed_row.size(), u | (u << 16));
+      }
+    } else {
+      const uint32_t chroma_stride = m_bytesperline / 2;
+      uint8_t* v_plane = chroma + size_t(chroma_stride) * chroma_height;
+      for (uint32_t i = 0; i < chroma_height; i++) {
+        memset(chroma + size_t(i) * chroma_stride, m_u_col[i], m_width / 2);
+        memcpy(v_plane + size_t(i) * chroma_stride, m_v_row.data(),
+               m_width / 2);
+      }
+    }
+  }
+
+  BurnIn(data, frame, timestamp_us);
+}
+
+void PatternGenerator::FillLuma(uint8_t* data,
+                                uint32_t x,
+                                uint32_t y,
+                                uint32_t w,
+                                uint32_t h,
+                                uint8_t value) {
+  const uint32_t x_end = std::min(x + w, m_width);
+  const uint32_t y_end = std::min(y + h, m_height);
+  for (uint32_t row = y; row < y_end; row++) {
+    uint8_t* line = data + size_t(row) * m_bytesperline;
+    for (uint32_t col = x; col < x_end; col++) {
+      line[col * m_luma_step] = value;
+    }
+  }
+}
+
+void PatternGenerator::BurnIn(uint8_t* data,
+                              uint64_t frame,
+                              uint64_t timestamp_us) {
+  // Stripe: 64 bits of frame counter then 64 bits of timestamp, MSB first
+  const uint32_t block_width = m_width / kStripeBits;
+  for (uint32_t bit = 0; bit < kStripeBits; bit++) {
+    const uint64_t word = bit < 64 ? frame : timestamp_us;
+    const bool set = (word >> (63 - bit % 64)) & 1;
+    FillLuma(data, bit * block_width, 0, block_width, kStripeRows,
+             set ? kWhite : kBlack);
+  }
+
+  // Digits: "<frame> <timestamp_us>" on a black box under the stripe
+  const std::string text =
+      std::to_string(frame) + " " + std::to_string(timestamp_us);
+  const uint32_t scale = std::max(1u, m_height / 120);
+  const uint32_t advance = 4 * scale;
+  const uint32_t top = kStripeRows + scale;
+  FillLuma(data, 0, kStripeRows, advance * text.size() + 2 * scale,
+           7 * scale, kBlack);
+  for (size_t c = 0; c < text.size(); c++) {
+    if (text[c] < '0' || text[c] > '9') {
+      continue;
+    }
+    const uint16_t glyph = kDigits[text[c] - '0'];
+    for (uint32_t gy = 0; gy < 5; gy++) {
+      for (uint32_t gx = 0; gx < 3; gx++) {
+        if ((glyph >> (14 - gy * 3 - gx)) & 1) {
+          FillLuma(data, scale + c * advance + gx * scale, top + gy * scale,
+                   scale, scale, kWhite);
+        }
+      }
+    }
+  }
+}
+
+bool PatternGenerator::Decode(const uint8_t* data,
+                              uint64_t* frame,
+                              uint64_t* timestamp_us) const {
+  const uint32_t block_width = m_width / kStripeBits;
+  const uint8_t* line = data + size_t(kStripeRows / 2) * m_bytesperline;
+
+  uint64_t words[2] = {0, 0};
+  for (uint32_t bit = 0; bit < kStripeBits; bit++) {
+    const uint8_t value =
+        line[(bit * block_width + block_width / 2) * m_luma_step];
+    if (value > kWhite - 32) {
+      words[bit / 64] |= 1ull << (63 - bit % 64);
+    } else if (value > kBlack + 32) {
+      // Not a stripe written by Fill
+      return false;
+    }
+  }
+
+  *frame = words[0];
+  *timestamp_us = words[1];
+  return true;
+}
@@ -0,0 +1,107 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __PATTERN_GENERATOR_H__
+#define __PATTERN_GENERATOR_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Generates an animated test pattern in YUYV, NV12 or I420 fast enough to
+// load consumers at hundreds of fps. Every frame only evaluates one row of
+// luma and chroma from lookup tables; the planes are then filled with row
+// copies and SIMD ORs.
+//
+// The frame counter and a timestamp are burned into the top rows as a 128
+// block black/white stripe, readable back with Decode(), and as digits below
+// it.
+class PatternGenerator {
+ public:
+  PatternGenerator(uint32_t pixelformat,
+                   uint32_t width,
+                   uint32_t height,
+                   uint32_t bytesperline);
+
+  static bool IsSupported(uint32_t pixelformat);
+
+  // Returns the bytesperline and frame size of a tightly packed frame
+  static uint32_t GetBytesPerLine(uint32_t pixelformat, uint32_t width);
+  static size_t GetFrameSize(uint32_t pixelformat,
+                             uint32_t bytesperline,
+                             uint32_t height);
+
+  // Writes the pattern of `frame` into a buffer of `len` bytes, which must
+  // hold a whole frame
+  void Fill(uint8_t* data,
+            size_t len,
+            uint64_t frame,
+            uint64_t timestamp_us);
+
+  // Reads back the frame counter and timestamp burned in by Fill
+  bool Decode(const uint8_t* data,
+              uint64_t* frame,
+              uint64_t* timestamp_us) const;
+
+ private:
+  void UpdateRows(uint64_t frame);
+  void BurnIn(uint8_t* data, uint64_t frame, uint64_t timestamp_us);
+  void FillLuma(uint8_t* data,
+                uint32_t x,
+                uint32_t y,
+                uint32_t w,
+                uint32_t h,
+                uint8_t value);
+
+  uint32_t m_pixelformat;
+  uint32_t m_width;
+  uint32_t m_height;
+  uint32_t m_bytesperline;
+  // Distance between two luma samples in a row
+  uint32_t m_luma_step;
+
+  // Per row and per column lookup tables, fixed for the frame size
+  std::vector<int16_t> m_wave_y;
+  std::vector<int16_t> m_wave_c;
+  std::vector<uint16_t> m_grad_y;
+  std::vector<uint16_t> m_phase_y;
+  std::vector<uint16_t> m_grad_u;
+  std::vector<uint16_t> m_phase_u;
+  std::vector<uint16_t> m_grad_v;
+  std::vector<uint16_t> m_phase_v;
+
+  // Rows of the current frame: luma, U per chroma row and V per chroma
+  // column, plus the interleaved YUYV or NV12 row with U left zero
+  std::vector<uint8_t> m_y_row;
+  std::vector<uint8_t> m_u_col;
+  std::vector<uint8_t> m_v_row;
+  std::vector<uint8_t> m_packed_row;
+};
+#endif /* __PATTERN_GENERATOR_H__ */
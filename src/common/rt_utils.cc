@@ -0,0 +1,259 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "rt_utils.h"
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+namespace {
+
+// Layout of the sched_setattr(2) argument, not exposed by every libc
+struct rt_sched_attr {
+  uint32_t size;
+  uint32_t sched_policy;
+  uint64_t sched_flags;
+  int32_t sched_nice;
+  uint32_t sched_priority;
+  uint64_t sched_runtime;
+  uint64_t sched_deadline;
+  uint64_t sched_period;
+};
+
+bool parse_int(const std::string& str, int* value) {
+  char* end = nullptr;
+  errno = 0;
+  long v = strtol(str.c_str(), &end, 10);
+  if (str.empty() || *end != '\0' || errno != 0 || v < 0 || v > 4096) {
+    return false;
+  }
+  *value = int(v);
+  return true;
+}
+
+bool parse_cpus(const std::string& cpus, std::vector<int>* list) {
+  std::stringstream stream(cpus);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    const size_t dash = item.find('-');
+    int first, last;
+    if (dash == std::string::npos) {
+      if (!parse_int(item, &first)) {
+        return false;
+      }
+      last = first;
+    } else if (!parse_int(item.substr(0, dash), &first) ||
+               !parse_int(item.substr(dash + 1), &last) || last < first) {
+      return false;
+    }
+    for (int cpu = first; cpu <= last; cpu++) {
+      list->push_back(cpu);
+    }
+  }
+  return true;
+}
+
+std::string read_locked_memory() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("VmLck:", 0) == 0) {
+      const size_t start = line.find_first_not_of(" \t", 6);
+      return start == std::string::npos ? "" : line.substr(start);
+    }
+  }
+  return "unknown";
+}
+
+}  // namespace
+
+bool rt_parse_profile(const std::string& sched,
+                      const std::string& cpus,
+                      bool lock_memory,
+                      RtProfile* profile) {
+  if (sched == "other") {
+    profile->sched = RtProfile::Sched::kOther;
+  } else if (sched == "deadline") {
+    profile->sched = RtProfile::Sched::kDeadline;
+  } else if (sched.rfind("fifo:", 0) == 0 &&
+             parse_int(sched.substr(5), &profile->priority) &&
+             profile->priority >= 1 && profile->priority <= 99) {
+    profile->sched = RtProfile::Sched::kFifo;
+  } else {
+    std::cout << "Invalid scheduling class: " << sched << std::endl;
+    return false;
+  }
+
+  profile->cpus.clear();
+  if (!parse_cpus(cpus, &profile->cpus)) {
+    std::cout << "Invalid CPU list: " << cpus << std::endl;
+    return false;
+  }
+
+  // Deadline tasks may not be pinned more narrowly than their root domain,
+  // so sched_setaffinity() would fail; isolate their CPUs with a cpuset
+  // instead.
+  if (profile->sched == RtProfile::Sched::kDeadline &&
+      !profile->cpus.empty()) {
+    std::cout << "--cpus cannot be used with --sched deadline" << std::endl;
+    return false;
+  }
+
+  profile->lock_memory = lock_memory;
+  return true;
+}
+
+bool rt_lock_memory(const RtProfile& profile) {
+  if (!profile.lock_memory) {
+    return true;
+  }
+
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+    std::cout << "mlockall failed: " << strerror(errno) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool rt_apply_thread(const RtProfile& profile,
+                     const std::string& name,
+                     v4l2_fract timeperframe) {
+  bool ok = true;
+
+  if (profile.sched == RtProfile::Sched::kFifo) {
+    sched_param param = {};
+    param.sched_priority = profile.priority;
+    if (sched_setscheduler(0, SCHED_FIFO, &param) < 0) {
+      std::cout << "sched_setscheduler(SCHED_FIFO) failed: "
+                << strerror(errno) << std::endl;
+      ok = false;
+    }
+  } else if (profile.sched == RtProfile::Sched::kDeadline) {
+    if (timeperframe.denominator == 0) {
+      std::cout << "SCHED_DEADLINE needs a known frame rate\n";
+      ok = false;
+    } else {
+      const uint64_t period_ns = 1000000000ull * timeperframe.numerator /
+                                 timeperframe.denominator;
+      rt_sched_attr attr = {};
+      attr.size = sizeof(attr);
+      attr.sched_policy = SCHED_DEADLINE;
+      attr.sched_runtime = period_ns / 2;
+      attr.sched_deadline = period_ns;
+      attr.sched_period = period_ns;
+      if (syscall(SYS_sched_setattr, 0, &attr, 0) < 0) {
+        std::cout << "sched_setattr(SCHED_DEADLINE) failed: "
+                  << strerror(errno) << std::endl;
+        ok = false;
+      }
+    }
+  }
+
+  // Never set with SCHED_DEADLINE, see rt_parse_profile()
+  if (!profile.cpus.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : profile.cpus) {
+      CPU_SET(cpu, &set);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+      std::cout << "sched_setaffinity failed: " << strerror(errno)
+                << std::endl;
+      ok = false;
+    }
+  }
+
+  // Report what the kernel actually applied
+  rt_sched_attr attr = {};
+  std::cout << "RT " << name << ": ";
+  if (syscall(SYS_sched_getattr, 0, &attr, sizeof(attr), 0) == 0) {
+    switch (attr.sched_policy) {
+      case SCHED_FIFO:
+        std::cout << "SCHED_FIFO priority " << attr.sched_priority;
+        break;
+      case SCHED_RR:
+        std::cout << "SCHED_RR priority " << attr.sched_priority;
+        break;
+      case SCHED_DEADLINE:
+        std::cout << "SCHED_DEADLINE runtime " << attr.sched_runtime / 1000
+                  << " us period " << attr.sched_period / 1000 << " us";
+        break;
+      default:
+        std::cout << "SCHED_OTHER nice " << attr.sched_nice;
+        break;
+    }
+  } else {
+    std::cout << "unknown policy";
+  }
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  std::cout << ", cpus";
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    std::string separator = " ";
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) {
+        std::cout << separator << cpu;
+        separator = ",";
+      }
+    }
+  }
+  std::cout << ", locked memory " << read_locked_memory() << std::endl;
+
+  return ok;
+}
+
+void rt_prefault(void* data, size_t len, bool writable) {
+  if (!data) {
+    return;
+  }
+
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  volatile uint8_t* bytes = static_cast<volatile uint8_t*>(data);
+  for (size_t offset = 0; offset < len; offset += page_size) {
+    const uint8_t value = bytes[offset];
+    if (writable) {
+      bytes[offset] = value;
+    }
+  }
+}
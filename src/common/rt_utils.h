@@ -0,0 +1,77 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __RT_UTILS_H__
+#define __RT_UTILS_H__
+
+#include <cstddef>
+
+#include <string>
+#include <vector>
+
+#include <linux/videodev2.h>
+
+// Real-time profile for the streaming loop: scheduling class, CPU pinning
+// and memory locking. The default profile changes nothing.
+struct RtProfile {
+  enum class Sched { kOther, kFifo, kDeadline };
+
+  Sched sched = Sched::kOther;
+  // SCHED_FIFO priority, 1..99
+  int priority = 0;
+
+  // CPUs the loop thread is pinned to; empty keeps the inherited mask.
+  // Always empty with kDeadline.
+  std::vector<int> cpus;
+
+  // mlockall() the process and prefault buffers before STREAMON
+  bool lock_memory = false;
+};
+
+// Parses `sched` as "other", "fifo:<priority>" or "deadline", and `cpus` as
+// a list such as "2,3" or "2-5". A CPU list is rejected with "deadline".
+bool rt_parse_profile(const std::string& sched,
+                      const std::string& cpus,
+                      bool lock_memory,
+                      RtProfile* profile);
+
+// Locks current and future mappings if the profile asks for it.
+bool rt_lock_memory(const RtProfile& profile);
+
+// Applies the scheduling class and CPU pinning to the calling thread and
+// reports the settings read back from the kernel. SCHED_DEADLINE reserves
+// half of `timeperframe` every frame interval.
+bool rt_apply_thread(const RtProfile& profile,
+                     const std::string& name,
+                     v4l2_fract timeperframe);
+
+// Touches every page of a mapping so it is resident before streaming.
+void rt_prefault(void* data, size_t len, bool writable);
+#endif /* __RT_UTILS_H__ */
@@ -0,0 +1,144 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "check.h"
+#include "scale_ladder.h"
+#include "trace.h"
+#include "yuv_utils.h"
+
+ScaleLadder::ScaleLadder(uint32_t format, uint32_t thread_count)
+    : m_format(format), m_band_count(std::max(thread_count, 1u)) {
+  for (uint32_t band = 1; band < m_band_count; band++) {
+    m_workers.emplace_back(&ScaleLadder::Run, this, band);
+  }
+}
+
+ScaleLadder::~ScaleLadder() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+    m_start.notify_all();
+  }
+  for (std::thread& worker : m_workers) {
+    worker.join();
+  }
+}
+
+void ScaleLadder::Scale(const Level& base, const std::vector<Level>& levels) {
+  const auto start = std::chrono::steady_clock::now();
+
+  if (m_taps.size() < levels.size()) {
+    m_taps.resize(levels.size());
+  }
+
+  // A level only starts once the one above it is complete
+  const Level* src = &base;
+  for (size_t i = 0; i < levels.size(); i++) {
+    const Level& dst = levels[i];
+    YuvScaleTaps& taps = m_taps[i];
+    if (taps.src_width != src->width || taps.src_height != src->height ||
+        taps.dst_width != dst.width || taps.dst_height != dst.height) {
+      taps = yuv_scale_taps(m_format, src->width, src->height, dst.width,
+                            dst.height);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_src = src;
+      m_dst = &dst;
+      m_step_taps = &taps;
+      m_pending = m_workers.size();
+      m_generation++;
+      m_start.notify_all();
+    }
+
+    ScaleBand(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_pending == 0; });
+    src = &dst;
+  }
+
+  m_frames++;
+  m_scale_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+}
+
+void ScaleLadder::Report() const {
+  std::cout << "Ladder: frames " << m_frames << ", " << m_band_count
+            << " threads";
+  if (m_frames) {
+    std::cout << ", " << m_scale_ns / 1000 / int64_t(m_frames)
+              << " us/frame";
+  }
+  std::cout << std::endl;
+}
+
+void ScaleLadder::Run(uint32_t band) {
+  Trace::SetThreadName("ladder");
+
+  uint64_t generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_start.wait(lock,
+                   [&]() { return m_stop || m_generation != generation; });
+      if (m_stop) {
+        break;
+      }
+      generation = m_generation;
+    }
+
+    ScaleBand(band);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (--m_pending == 0) {
+      m_done.notify_one();
+    }
+  }
+}
+
+// Bands start on even rows so 4:2:0 chroma rows split with them
+void ScaleLadder::ScaleBand(uint32_t band) {
+  ScopedTrace trace("scale band");
+
+  const uint32_t height = m_dst->height;
+  const uint32_t row_begin = (height * band / m_band_count) & ~1u;
+  const uint32_t row_end = band + 1 == m_band_count
+                               ? height
+                               : (height * (band + 1) / m_band_count) & ~1u;
+  CHECK(yuv_scale_rows(*m_step_taps, m_src->data, m_src->stride, m_dst->data,
+                       m_dst->stride, row_begin, row_end));
+}
@@ -0,0 +1,97 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __SCALE_LADDER_H__
+#define __SCALE_LADDER_H__
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "yuv_utils.h"
+
+// Downscale pyramid for publishing one frame at several resolutions. Each
+// level is scaled from the level above it rather than from the full frame,
+// so every step stays small enough for a bilinear filter and reads a
+// smaller source. The rows of each level are split into bands scaled in
+// parallel by the calling thread and a pool of workers.
+class ScaleLadder {
+ public:
+  // A frame in a single-plane V4L2 layout, usually an output device buffer
+  struct Level {
+    uint8_t* data;
+    uint32_t stride;
+    uint32_t width;
+    uint32_t height;
+  };
+
+  // `format` is V4L2_PIX_FMT_YUYV, NV12 or YUV420; `thread_count` includes
+  // the calling thread
+  ScaleLadder(uint32_t format, uint32_t thread_count);
+  ~ScaleLadder();
+
+  ScaleLadder(const ScaleLadder&) = delete;
+  ScaleLadder& operator=(const ScaleLadder&) = delete;
+
+  // Scales `base` into levels[0], then each level into the next
+  void Scale(const Level& base, const std::vector<Level>& levels);
+
+  void Report() const;
+
+ private:
+  void Run(uint32_t band);
+  void ScaleBand(uint32_t band);
+
+  uint32_t m_format;
+  uint32_t m_band_count;
+
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_start;
+  std::condition_variable m_done;
+  uint64_t m_generation = 0;
+  uint32_t m_pending = 0;
+  bool m_stop = false;
+
+  // Taps of each step, built when the sizes of a step change: at the first
+  // frame, or when a lost rung makes the next one scale from another level
+  std::vector<YuvScaleTaps> m_taps;
+
+  // The step being scaled
+  const Level* m_src = nullptr;
+  const Level* m_dst = nullptr;
+  const YuvScaleTaps* m_step_taps = nullptr;
+
+  uint64_t m_frames = 0;
+  int64_t m_scale_ns = 0;
+};
+#endif /* __SCALE_LADDER_H__ */
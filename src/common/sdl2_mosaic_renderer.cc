@@ -0,0 +1,322 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+#include <libyuv.h>
+
+#include "check.h"
+#include "sdl2_mosaic_renderer.h"
+#include "sdl2_video_renderer.h"
+#include "trace.h"
+#include "yuv_utils.h"
+
+SDL2MosaicRenderer::SDL2MosaicRenderer(const char* name,
+                                       uint32_t tile_count,
+                                       const int window_width,
+                                       const int window_height,
+                                       const char* driver)
+    : m_atlas_width(window_width & ~1), m_atlas_height(window_height & ~1) {
+  CHECK(name);
+  CHECK(tile_count);
+  CHECK(m_atlas_width > 0);
+  CHECK(m_atlas_height > 0);
+
+  if (!SDL_WasInit(SDL_INIT_VIDEO)) {
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+      std::cout << "Unable to initialize SDL: " << SDL_GetError() << std::endl;
+      CHECK(0);
+    }
+  }
+
+  m_window = SDL_CreateWindow(name, SDL_WINDOWPOS_CENTERED,
+                              SDL_WINDOWPOS_CENTERED, m_atlas_width,
+                              m_atlas_height, SDL_WINDOW_SHOWN);
+  if (!m_window) {
+    std::cout << "Could not create SDL window: " << SDL_GetError() << std::endl;
+    CHECK(0);
+  }
+
+  int driver_index = -1;
+  if (driver) {
+    for (int i = 0; i < SDL_GetNumRenderDrivers(); i++) {
+      SDL_RendererInfo info = {};
+      if (SDL_GetRenderDriverInfo(i, &info) == 0 &&
+          strcmp(info.name, driver) == 0) {
+        driver_index = i;
+        break;
+      }
+    }
+    if (driver_index < 0) {
+      std::cout << "Unknown SDL render driver: " << driver << std::endl;
+      CHECK(0);
+    }
+  }
+
+  // Presents are paced by the display, stream updates are not
+  m_renderer =
+      SDL_CreateRenderer(m_window, driver_index, SDL_RENDERER_PRESENTVSYNC);
+  if (!m_renderer) {
+    std::cout << "Could not create SDL renderer: " << SDL_GetError()
+              << std::endl;
+    CHECK(0);
+  }
+
+  m_texture = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_IYUV,
+                                SDL_TEXTUREACCESS_STREAMING, m_atlas_width,
+                                m_atlas_height);
+  if (!m_texture) {
+    std::cout << "Could not create SDL texture: " << SDL_GetError()
+              << std::endl;
+    CHECK(0);
+  }
+
+  // Near-square grid of even-sized tiles
+  const uint32_t cols = std::ceil(std::sqrt(tile_count));
+  const uint32_t rows = (tile_count + cols - 1) / cols;
+  const uint32_t tile_width = (m_atlas_width / cols) & ~1u;
+  const uint32_t tile_height = (m_atlas_height / rows) & ~1u;
+  CHECK(tile_width >= 2 && tile_height >= 2);
+
+  m_tiles.resize(tile_count);
+  for (uint32_t i = 0; i < tile_count; i++) {
+    m_tiles[i].x = (i % cols) * tile_width;
+    m_tiles[i].y = (i / cols) * tile_height;
+    m_tiles[i].width = tile_width;
+    m_tiles[i].height = tile_height;
+  }
+
+  std::cout << "Create mosaic " << m_atlas_width << "x" << m_atlas_height
+            << ", " << cols << "x" << rows << " tiles of " << tile_width << "x"
+            << tile_height << std::endl;
+
+  LockAtlas();
+  ClearRegion(GetRegion(0, 0, m_atlas_width, m_atlas_height));
+  m_dirty = true;
+}
+
+SDL2MosaicRenderer::~SDL2MosaicRenderer() {
+  if (m_texture) {
+    if (m_pixels) {
+      SDL_UnlockTexture(m_texture);
+    }
+    SDL_DestroyTexture(m_texture);
+    m_texture = nullptr;
+  }
+
+  if (m_renderer) {
+    SDL_DestroyRenderer(m_renderer);
+    m_renderer = nullptr;
+  }
+
+  if (m_window) {
+    SDL_DestroyWindow(m_window);
+    m_window = nullptr;
+  }
+
+  if (SDL_WasInit(SDL_INIT_VIDEO)) {
+    SDL_Quit();
+  }
+}
+
+void SDL2MosaicRenderer::LockAtlas() {
+  void* pixels = nullptr;
+  if (SDL_LockTexture(m_texture, nullptr, &pixels, &m_pitch) != 0) {
+    std::cout << "Could not lock SDL texture: " << SDL_GetError() << std::endl;
+    CHECK(0);
+  }
+  m_pixels = static_cast<uint8_t*>(pixels);
+}
+
+SDL2MosaicRenderer::Region SDL2MosaicRenderer::GetRegion(uint32_t x,
+                                                         uint32_t y,
+                                                         uint32_t width,
+                                                         uint32_t height) {
+  // IYUV planes are contiguous in the locked buffer, chroma at half pitch
+  const uint32_t uv_pitch = m_pitch / 2;
+  uint8_t* u_plane = m_pixels + m_pitch * m_atlas_height;
+  uint8_t* v_plane = u_plane + uv_pitch * m_atlas_height / 2;
+
+  Region region;
+  region.y = m_pixels + y * m_pitch + x;
+  region.u = u_plane + y / 2 * uv_pitch + x / 2;
+  region.v = v_plane + y / 2 * uv_pitch + x / 2;
+  region.width = width;
+  region.height = height;
+  return region;
+}
+
+void SDL2MosaicRenderer::ClearRegion(const Region& region) {
+  const uint32_t uv_pitch = m_pitch / 2;
+  libyuv::SetPlane(region.y, m_pitch, region.width, region.height, 16);
+  libyuv::SetPlane(region.u, uv_pitch, region.width / 2, region.height / 2,
+                   128);
+  libyuv::SetPlane(region.v, uv_pitch, region.width / 2, region.height / 2,
+                   128);
+}
+
+SDL2MosaicRenderer::Region SDL2MosaicRenderer::BeginTile(uint32_t index,
+                                                         uint32_t width,
+                                                         uint32_t height,
+                                                         uint32_t* factor) {
+  CHECK(index < m_tiles.size());
+  Tile& tile = m_tiles[index];
+
+  if (tile.src_width != width || tile.src_height != height) {
+    // Smallest integer factor that fits the frame into the tile
+    tile.factor = std::max((width + tile.width - 1) / tile.width,
+                           (height + tile.height - 1) / tile.height);
+    tile.src_width = width;
+    tile.src_height = height;
+    ClearRegion(GetRegion(tile.x, tile.y, tile.width, tile.height));
+  }
+
+  const uint32_t dst_width = (width / tile.factor) & ~1u;
+  const uint32_t dst_height = (height / tile.factor) & ~1u;
+  const uint32_t x = tile.x + ((tile.width - dst_width) / 2 & ~1u);
+  const uint32_t y = tile.y + ((tile.height - dst_height) / 2 & ~1u);
+
+  *factor = tile.factor;
+  return GetRegion(x, y, dst_width, dst_height);
+}
+
+void SDL2MosaicRenderer::UpdateTileYUY2(uint32_t index,
+                                        uint32_t width,
+                                        uint32_t height,
+                                        const uint8_t* data,
+                                        uint32_t stride) {
+  ScopedTrace trace("tile update", index);
+  std::shared_lock lock(m_mutex);
+  const uint32_t uv_pitch = m_pitch / 2;
+
+  uint32_t factor;
+  const Region region = BeginTile(index, width, height, &factor);
+  if (factor > 1) {
+    yuv_yuy2_to_i420_box(data, stride, width, height, factor, region.y,
+                         m_pitch, region.u, uv_pitch, region.v, uv_pitch,
+                         &m_tiles[index].scratch);
+  } else {
+    libyuv::YUY2ToI420(data, stride, region.y, m_pitch, region.u, uv_pitch,
+                       region.v, uv_pitch, region.width, region.height);
+  }
+
+  m_tile_update_count++;
+  m_dirty = true;
+}
+
+void SDL2MosaicRenderer::UpdateTileNV12(uint32_t index,
+                                        uint32_t width,
+                                        uint32_t height,
+                                        const uint8_t* y_data,
+                                        uint32_t y_stride,
+                                        const uint8_t* uv_data,
+                                        uint32_t uv_stride) {
+  ScopedTrace trace("tile update", index);
+  std::shared_lock lock(m_mutex);
+  const uint32_t uv_pitch = m_pitch / 2;
+
+  uint32_t factor;
+  const Region region = BeginTile(index, width, height, &factor);
+  if (factor > 1) {
+    yuv_nv12_to_i420_box(y_data, y_stride, uv_data, uv_stride, width, height,
+                         factor, region.y, m_pitch, region.u, uv_pitch,
+                         region.v, uv_pitch, &m_tiles[index].scratch);
+  } else {
+    libyuv::NV12ToI420(y_data, y_stride, uv_data, uv_stride, region.y,
+                       m_pitch, region.u, uv_pitch, region.v, uv_pitch,
+                       region.width, region.height);
+  }
+
+  m_tile_update_count++;
+  m_dirty = true;
+}
+
+void SDL2MosaicRenderer::UpdateTileI420(uint32_t index,
+                                        uint32_t width,
+                                        uint32_t height,
+                                        const uint8_t* y_data,
+                                        uint32_t y_stride,
+                                        const uint8_t* u_data,
+                                        uint32_t u_stride,
+                                        const uint8_t* v_data,
+                                        uint32_t v_stride) {
+  ScopedTrace trace("tile update", index);
+  std::shared_lock lock(m_mutex);
+  const uint32_t uv_pitch = m_pitch / 2;
+
+  uint32_t factor;
+  const Region region = BeginTile(index, width, height, &factor);
+  if (factor > 1) {
+    // No conversion needed, libyuv box filters straight into the tile
+    libyuv::I420Scale(y_data, y_stride, u_data, u_stride, v_data, v_stride,
+                      width, height, region.y, m_pitch, region.u, uv_pitch,
+                      region.v, uv_pitch, region.width, region.height,
+                      libyuv::kFilterBox);
+  } else {
+    libyuv::I420Copy(y_data, y_stride, u_data, u_stride, v_data, v_stride,
+                     region.y, m_pitch, region.u, uv_pitch, region.v, uv_pitch,
+                     region.width, region.height);
+  }
+
+  m_tile_update_count++;
+  m_dirty = true;
+}
+
+bool SDL2MosaicRenderer::Present() {
+  SDL2HandleEvent();
+
+  if (!m_dirty.exchange(false)) {
+    SDL_Delay(1);
+    return false;
+  }
+
+  {
+    // Upload and relock with the writers held off; the vsync wait below
+    // runs without the lock so streams keep writing during it.
+    ScopedTrace trace("atlas upload");
+    std::unique_lock lock(m_mutex);
+    SDL_UnlockTexture(m_texture);
+    m_pixels = nullptr;
+    SDL_RenderClear(m_renderer);
+    SDL_RenderCopy(m_renderer, m_texture, nullptr, nullptr);
+    LockAtlas();
+  }
+
+  {
+    ScopedTrace trace("present");
+    SDL_RenderPresent(m_renderer);
+  }
+  m_present_count++;
+  return true;
+}
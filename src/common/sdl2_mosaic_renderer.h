@@ -0,0 +1,157 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __SDL2_MOSAIC_RENDERER_H__
+#define __SDL2_MOSAIC_RENDERER_H__
+
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#include "yuv_utils.h"
+
+// Composites several streams into one window. The window owns a single
+// streaming I420 texture used as an atlas of equally sized tiles, one per
+// stream. Streams convert and box downscale their frames straight into their
+// tile of the locked texture, keeping the aspect ratio, from any thread.
+// Present() uploads the atlas and presents it once per display refresh no
+// matter how many streams are active.
+//
+// The texture stays locked between presents. This relies on SDL keeping the
+// contents of the locked staging buffer of YUV streaming textures, so tiles
+// that did not change are not redrawn.
+class SDL2MosaicRenderer {
+ public:
+  SDL2MosaicRenderer(const char* name,
+                     uint32_t tile_count,
+                     const int window_width = 1280,
+                     const int window_height = 720,
+                     const char* driver = nullptr);
+  ~SDL2MosaicRenderer();
+
+  uint32_t GetTileCount() const { return m_tiles.size(); }
+
+  // Write a frame into tile `index`. Different tiles can be updated
+  // concurrently; each tile must be fed by a single thread.
+  void UpdateTileYUY2(uint32_t index,
+                      uint32_t width,
+                      uint32_t height,
+                      const uint8_t* data,
+                      uint32_t stride);
+
+  void UpdateTileNV12(uint32_t index,
+                      uint32_t width,
+                      uint32_t height,
+                      const uint8_t* y_data,
+                      uint32_t y_stride,
+                      const uint8_t* uv_data,
+                      uint32_t uv_stride);
+
+  void UpdateTileI420(uint32_t index,
+                      uint32_t width,
+                      uint32_t height,
+                      const uint8_t* y_data,
+                      uint32_t y_stride,
+                      const uint8_t* u_data,
+                      uint32_t u_stride,
+                      const uint8_t* v_data,
+                      uint32_t v_stride);
+
+  // Presents the atlas if any tile changed since the last present, waiting
+  // for the display refresh. Returns false without presenting otherwise,
+  // after a short sleep so it can be called in a loop.
+  bool Present();
+
+  uint64_t GetPresentCount() const { return m_present_count; }
+  uint64_t GetTileUpdateCount() const { return m_tile_update_count; }
+
+ private:
+  struct Tile {
+    // Position and size of the tile in the atlas
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+
+    // Source size and box factor of the last frame, to clear the letterbox
+    // when they change
+    uint32_t src_width = 0;
+    uint32_t src_height = 0;
+    uint32_t factor = 0;
+
+    // Box downscale memory of the stream writing this tile
+    YuvScratch scratch;
+  };
+
+  // Plane pointers of a region of the locked atlas
+  struct Region {
+    uint8_t* y;
+    uint8_t* u;
+    uint8_t* v;
+    uint32_t width;
+    uint32_t height;
+  };
+
+  // Returns the region of tile `index` a width x height frame is written to
+  // after box downscaling by `factor`, centered in the tile. The tile is
+  // cleared first when the source size changed. Must be called with the
+  // shared lock held.
+  Region BeginTile(uint32_t index,
+                   uint32_t width,
+                   uint32_t height,
+                   uint32_t* factor);
+  Region GetRegion(uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+  void ClearRegion(const Region& region);
+
+  void LockAtlas();
+
+  int32_t m_atlas_width;
+  int32_t m_atlas_height;
+
+  SDL_Window* m_window = nullptr;
+  SDL_Renderer* m_renderer = nullptr;
+  SDL_Texture* m_texture = nullptr;
+
+  std::vector<Tile> m_tiles;
+
+  // Held shared by tile writers and exclusively while the atlas is
+  // unlocked for upload
+  std::shared_mutex m_mutex;
+  uint8_t* m_pixels = nullptr;
+  int m_pitch = 0;
+
+  std::atomic<bool> m_dirty = false;
+  std::atomic<uint64_t> m_present_count = 0;
+  std::atomic<uint64_t> m_tile_update_count = 0;
+};
+#endif /* __SDL2_MOSAIC_RENDERER_H__ */
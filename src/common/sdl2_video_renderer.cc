@@ -28,12 +28,12 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
-#include <vector>
-
-#include <libyuv.h>
+#include <cstring>
+#include <iostream>
 
 #include "check.h"
 #include "sdl2_video_renderer.h"
+#include "trace.h"
 
 void SDL2HandleEvent() {
   SDL_Event event;
@@ -60,13 +60,38 @@ void SDL2HandleEvent() {
 
 SDL2VideoRenderer::SDL2VideoRenderer(const char* name,
                                      const int window_width,
-                                     const int window_height)
+                                     const int window_height,
+                                     const char* driver,
+                                     bool vsync,
+                                     bool offscreen)
     : m_window_width(window_width), m_window_height(window_height) {
   CHECK(name);
   CHECK(window_width);
   CHECK(window_height);
   // SDL_LogSetAllPriority(SDL_LOG_PRIORITY_VERBOSE);
 
+  if (offscreen) {
+    // The software renderer draws into a plain surface and needs neither
+    // the video subsystem nor a display
+    m_surface = SDL_CreateRGBSurfaceWithFormat(
+        0, m_window_width, m_window_height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!m_surface) {
+      std::cout << "Could not create SDL surface: " << SDL_GetError()
+                << std::endl;
+      CHECK(0);
+    }
+
+    m_renderer = SDL_CreateSoftwareRenderer(m_surface);
+    if (!m_renderer) {
+      std::cout << "Could not create SDL renderer: " << SDL_GetError()
+                << std::endl;
+      CHECK(0);
+    }
+    std::cout << "Create offscreen renderer " << m_window_width << "x"
+              << m_window_height << std::endl;
+    return;
+  }
+
   if (!SDL_WasInit(SDL_INIT_VIDEO)) {
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
       std::cout << "Unable to initialize SDL: " << SDL_GetError() << std::endl;
@@ -76,7 +101,8 @@ SDL2VideoRenderer::SDL2VideoRenderer(const char* name,
 
   m_window =
       SDL_CreateWindow(name, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                       m_window_width, m_window_height, SDL_WINDOW_SHOWN);
+                       m_window_width, m_window_height,
+                       SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
   if (!m_window) {
     std::cout << "Could not create SDL window: " << SDL_GetError() << std::endl;
     CHECK(0);
@@ -84,12 +110,39 @@ SDL2VideoRenderer::SDL2VideoRenderer(const char* name,
   std::cout << "Create window " << m_window_width << "x" << m_window_height
             << std::endl;
 
-  m_renderer = SDL_CreateRenderer(m_window, -1, 0);
+  int driver_index = -1;
+  if (driver) {
+    for (int i = 0; i < SDL_GetNumRenderDrivers(); i++) {
+      SDL_RendererInfo info = {};
+      if (SDL_GetRenderDriverInfo(i, &info) == 0 &&
+          strcmp(info.name, driver) == 0) {
+        driver_index = i;
+        break;
+      }
+    }
+    if (driver_index < 0) {
+      std::cout << "Unknown SDL render driver: " << driver << std::endl;
+      CHECK(0);
+    }
+  }
+
+  m_renderer = SDL_CreateRenderer(m_window, driver_index,
+                                  vsync ? SDL_RENDERER_PRESENTVSYNC : 0);
   if (!m_renderer) {
     std::cout << "Could not create SDL renderer: " << SDL_GetError()
               << std::endl;
     CHECK(0);
   }
+  std::cout << "Create renderer " << GetDriverName() << ", vsync " << vsync
+            << std::endl;
+}
+
+std::string SDL2VideoRenderer::GetDriverName() const {
+  SDL_RendererInfo info = {};
+  if (SDL_GetRendererInfo(m_renderer, &info) != 0) {
+    return "unknown";
+  }
+  return info.name;
 }
 
 SDL2VideoRenderer::~SDL2VideoRenderer() {
@@ -103,6 +156,11 @@ SDL2VideoRenderer::~SDL2VideoRenderer() {
     m_renderer = nullptr;
   }
 
+  if (m_surface) {
+    SDL_FreeSurface(m_surface);
+    m_surface = nullptr;
+  }
+
   if (m_window) {
     SDL_DestroyWindow(m_window);
     m_window = nullptr;
@@ -123,6 +181,13 @@ void SDL2VideoRenderer::RenderFrameI420(uint32_t width,
                                         uint32_t v_pitch) {
   int ret;
 
+  // Recreate the texture whenever the uploaded size changes, e.g. when the
+  // downscaled preview follows a window resize.
+  if (m_texture && (m_texture_width != width || m_texture_height != height)) {
+    SDL_DestroyTexture(m_texture);
+    m_texture = nullptr;
+  }
+
   if (!m_texture) {
     std::cout << "Create texture " << width << "x" << height << std::endl;
 
@@ -133,55 +198,48 @@ void SDL2VideoRenderer::RenderFrameI420(uint32_t width,
                 << std::endl;
       CHECK(0);
     }
+    m_texture_width = width;
+    m_texture_height = height;
   }
 
-  ret = SDL_UpdateYUVTexture(m_texture, nullptr, y_data, y_pitch, u_data,
-                             u_pitch, v_data, v_pitch);
+  const Clock::time_point start = Clock::now();
+  {
+    ScopedTrace trace("texture update");
+    ret = SDL_UpdateYUVTexture(m_texture, nullptr, y_data, y_pitch, u_data,
+                               u_pitch, v_data, v_pitch);
+  }
   if (ret != 0) {
     std::cout << "Could not update SDL texture: " << SDL_GetError()
               << std::endl;
     return;
   }
+  const Clock::time_point updated = Clock::now();
 
-  SDL_RenderClear(m_renderer);
-  SDL_RenderCopy(m_renderer, m_texture, nullptr, nullptr);
-  SDL_RenderPresent(m_renderer);
+  {
+    ScopedTrace trace("render copy");
+    SDL_RenderClear(m_renderer);
+    SDL_RenderCopy(m_renderer, m_texture, nullptr, nullptr);
+  }
+  const Clock::time_point copied = Clock::now();
 
-  m_frame_count++;
+  {
+    ScopedTrace trace("present");
+    SDL_RenderPresent(m_renderer);
+  }
+  const Clock::time_point presented = Clock::now();
 
-  SDL2HandleEvent();
-}
+  m_stats.frames++;
+  m_stats.update_ns += ElapsedNs(start, updated);
+  m_stats.copy_ns += ElapsedNs(updated, copied);
+  m_stats.present_ns += ElapsedNs(copied, presented);
 
-void SDL2VideoRenderer::RenderFrameYUY2(uint32_t width,
-                                        uint32_t height,
-                                        const uint8_t* data,
-                                        uint32_t stride) {
-  const size_t i420_size = width * height * 3 / 2;
-  std::vector<uint8_t> i420_frame(i420_size);
-  libyuv::YUY2ToI420(data, stride, i420_frame.data(), width,
-                     i420_frame.data() + width * height, width / 2,
-                     i420_frame.data() + width * height * 5 / 4, width / 2,
-                     width, height);
-
-  RenderFrameI420(width, height, i420_frame.data(), width,
-                  i420_frame.data() + width * height, width / 2,
-                  i420_frame.data() + width * height * 5 / 4, width / 2);
+  m_frame_count++;
+
+  if (m_window) {
+    SDL2HandleEvent();
+  }
 }
 
-void SDL2VideoRenderer::RenderFrameNV12(uint32_t width,
-                                        uint32_t height,
-                                        const uint8_t* y_data,
-                                        int y_stride,
-                                        const uint8_t* uv_data,
-                                        int uv_stride) {
-  const size_t i420_size = width * height * 3 / 2;
-  std::vector<uint8_t> i420_frame(i420_size);
-  libyuv::NV12ToI420(y_data, y_stride, uv_data, uv_stride, i420_frame.data(),
-                     width, i420_frame.data() + width * height, width / 2,
-                     i420_frame.data() + width * height * 5 / 4, width / 2,
-                     width, height);
-
-  RenderFrameI420(width, height, i420_frame.data(), width,
-                  i420_frame.data() + width * height, width / 2,
-                  i420_frame.data() + width * height * 5 / 4, width / 2);
+bool SDL2VideoRenderer::GetOutputSize(int* width, int* height) {
+  return SDL_GetRendererOutputSize(m_renderer, width, height) == 0;
 }
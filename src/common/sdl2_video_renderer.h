@@ -37,12 +37,27 @@
 
 #include <SDL2/SDL.h>
 
-class SDL2VideoRenderer {
+#include "video_renderer.h"
+
+// Polls one pending SDL event; quits on window close, Escape or Q.
+void SDL2HandleEvent();
+
+class SDL2VideoRenderer : public VideoRenderer {
  public:
+  // `driver` selects an SDL render driver by name, e.g. "software" or
+  // "opengl", or the default one when null. With `vsync` every present waits
+  // for the display refresh. With `offscreen` frames are rendered by the
+  // software renderer into a window-sized memory surface instead, and
+  // `driver` and `vsync` are ignored.
   SDL2VideoRenderer(const char* name = "SDL2VideoRenderer",
                     const int window_width = 640,
-                    const int window_height = 360);
-  ~SDL2VideoRenderer();
+                    const int window_height = 360,
+                    const char* driver = nullptr,
+                    bool vsync = false,
+                    bool offscreen = false);
+  ~SDL2VideoRenderer() override;
+
+  std::string GetDriverName() const override;
 
   void RenderFrameI420(uint32_t width,
                        uint32_t height,
@@ -51,19 +66,10 @@ class SDL2VideoRenderer {
                        const uint8_t* u_data,
                        uint32_t u_pitch,
                        const uint8_t* v_data,
-                       uint32_t v_pitch);
+                       uint32_t v_pitch) override;
 
-  void RenderFrameNV12(uint32_t width,
-                       uint32_t height,
-                       const uint8_t* y_data,
-                       int y_stride,
-                       const uint8_t* uv_data,
-                       int uv_stride);
-
-  void RenderFrameYUY2(uint32_t width,
-                       uint32_t height,
-                       const uint8_t* data,
-                       uint32_t stride);
+ protected:
+  bool GetOutputSize(int* width, int* height) override;
 
  private:
   int32_t m_window_width;
@@ -72,7 +78,10 @@ class SDL2VideoRenderer {
   int32_t m_frame_count = 0;
 
   SDL_Window* m_window = nullptr;
+  SDL_Surface* m_surface = nullptr;
   SDL_Renderer* m_renderer = nullptr;
   SDL_Texture* m_texture = nullptr;
+  uint32_t m_texture_width = 0;
+  uint32_t m_texture_height = 0;
 };
 #endif /* __SDL2_VIDEO_RENDERER_H__ */
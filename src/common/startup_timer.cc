@@ -0,0 +1,108 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "startup_timer.h"
+
+namespace {
+
+struct StartupStep {
+  std::string name;
+  StartupTimer::Clock::time_point start;
+  StartupTimer::Clock::duration duration;
+  uint32_t count;
+};
+
+// Initialized before main, close enough to process start
+const StartupTimer::Clock::time_point g_process_start =
+    StartupTimer::Clock::now();
+
+std::mutex g_mutex;
+std::vector<StartupStep> g_steps;
+bool g_reported = false;
+
+double to_ms(StartupTimer::Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}  // namespace
+
+void StartupTimer::Record(const std::string& name,
+                          Clock::time_point start,
+                          Clock::time_point end) {
+  std::lock_guard<std::mutex> lock(g_mutex);
+
+  auto it = std::find_if(g_steps.begin(), g_steps.end(),
+                         [&](const StartupStep& s) { return s.name == name; });
+  if (it != g_steps.end()) {
+    it->duration += end - start;
+    it->count++;
+    return;
+  }
+
+  g_steps.push_back({name, start, end - start, 1});
+}
+
+void StartupTimer::Mark(const std::string& name) {
+  Clock::time_point now = Clock::now();
+  Record(name, now, now);
+}
+
+void StartupTimer::Report() {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  if (g_reported) {
+    return;
+  }
+  g_reported = true;
+
+  std::vector<StartupStep> steps = g_steps;
+  std::stable_sort(steps.begin(), steps.end(),
+                   [](const StartupStep& a, const StartupStep& b) {
+                     return a.start < b.start;
+                   });
+
+  std::cout << "====== Startup (ms): start, duration\n";
+  for (const StartupStep& step : steps) {
+    std::cout << "  " << std::left << std::setw(32) << step.name << std::right
+              << std::fixed << std::setprecision(2) << std::setw(10)
+              << to_ms(step.start - g_process_start) << std::setw(10)
+              << to_ms(step.duration);
+    if (step.count > 1) {
+      std::cout << " (x" << step.count << ")";
+    }
+    std::cout << std::endl;
+  }
+  std::cout << std::defaultfloat;
+}
@@ -28,34 +28,41 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
-#ifndef __OUTPUT_DEVICE_DMABUF_H__
-#define __OUTPUT_DEVICE_DMABUF_H__
+#ifndef __STARTUP_TIMER_H__
+#define __STARTUP_TIMER_H__
 
-#include <memory>
-#include <vector>
+#include <chrono>
+#include <string>
+#include <utility>
 
-#include "drm_prime_dmabuf.h"
-#include "v4l2_device.h"
-
-class OutputDeviceDmabuf : public V4L2Device {
+// Process-wide record of bring-up steps, reported as a breakdown relative to
+// process start. Safe to use from concurrent bring-up threads. Steps recorded
+// more than once under the same name are accumulated.
+class StartupTimer {
  public:
-  OutputDeviceDmabuf(int fd, int width, int height);
-  ~OutputDeviceDmabuf();
+  using Clock = std::chrono::steady_clock;
 
-  void Initialize(int bufffer_count) override;
-  void Start() override;
+  static void Record(const std::string& name,
+                     Clock::time_point start,
+                     Clock::time_point end);
 
-  void Queue(V4L2DeviceBuffer device_buffer) override;
-  V4L2DeviceBuffer Dequeue() override;
+  // Records a point in time, e.g. the first dequeued frame
+  static void Mark(const std::string& name);
 
- private:
-  int m_fd;
-  int m_width;
-  int m_height;
+  // Prints the breakdown once; later calls are ignored
+  static void Report();
+};
 
-  std::vector<V4L2DeviceBuffer> m_device_buffers;
+class ScopedStartupTimer {
+ public:
+  explicit ScopedStartupTimer(std::string name)
+      : m_name(std::move(name)), m_start(StartupTimer::Clock::now()) {}
+  ~ScopedStartupTimer() {
+    StartupTimer::Record(m_name, m_start, StartupTimer::Clock::now());
+  }
 
-  int m_drm_fd = -1;
-  std::vector<std::shared_ptr<DrmPrimeDmabuf>> m_dmabufs;
+ private:
+  std::string m_name;
+  StartupTimer::Clock::time_point m_start;
 };
-#endif /* __OUTPUT_DEVICE_DMABUF_H__ */
+#endif /* __STARTUP_TIMER_H__ */
@@ -0,0 +1,217 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "trace.h"
+
+namespace {
+
+// Newest events kept per thread, 2 MB
+constexpr uint64_t kRingSize = 1 << 16;
+
+struct TraceEvent {
+  const char* name;
+  int64_t begin_ns;
+  int64_t end_ns;
+  int64_t arg;
+};
+
+// Written by its thread only; `count` is published after each event
+struct ThreadRing {
+  pid_t tid;
+  std::string name;
+  std::unique_ptr<TraceEvent[]> events;
+  std::atomic<uint64_t> count{0};
+};
+
+std::mutex g_mutex;
+// Rings outlive their threads, so a dump still shows threads that exited
+std::vector<std::unique_ptr<ThreadRing>> g_rings;
+std::string g_path;
+int64_t g_enabled_ns = 0;
+std::atomic<bool> g_initialized{false};
+
+thread_local ThreadRing* t_ring = nullptr;
+thread_local std::string t_name;
+
+ThreadRing* GetThreadRing() {
+  if (!t_ring) {
+    auto ring = std::make_unique<ThreadRing>();
+    ring->tid = syscall(SYS_gettid);
+    ring->name =
+        t_name.empty() ? "thread " + std::to_string(ring->tid) : t_name;
+    ring->events = std::make_unique<TraceEvent[]>(kRingSize);
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    t_ring = ring.get();
+    g_rings.push_back(std::move(ring));
+  }
+  return t_ring;
+}
+
+// Writes the events recorded since tracing was turned on. Tracing must be
+// off.
+bool WriteTrace(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "w");
+  if (!file) {
+    std::cout << "Could not open trace file " << path << std::endl;
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(g_mutex);
+  const int pid = getpid();
+  uint64_t events = 0;
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  const char* separator = "\n";
+  for (const std::unique_ptr<ThreadRing>& ring : g_rings) {
+    fprintf(file,
+            "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+            "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            separator, pid, ring->tid, ring->name.c_str());
+    separator = ",\n";
+
+    // Record drops events once tracing is off, so only a Record that saw it
+    // on just before can still be writing, into the oldest slot. Skip it.
+    const uint64_t count = ring->count.load(std::memory_order_acquire);
+    const uint64_t first = count >= kRingSize ? count - kRingSize + 1 : 0;
+    for (uint64_t i = first; i < count; i++) {
+      const TraceEvent& event = ring->events[i % kRingSize];
+      if (event.begin_ns < g_enabled_ns) {
+        continue;
+      }
+      fprintf(file,
+              ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+              "\"ts\":%.3f,\"dur\":%.3f",
+              event.name, pid, ring->tid, event.begin_ns / 1000.0,
+              (event.end_ns - event.begin_ns) / 1000.0);
+      if (event.arg >= 0) {
+        fprintf(file, ",\"args\":{\"frame\":%" PRId64 "}", event.arg);
+      }
+      fprintf(file, "}");
+      events++;
+    }
+  }
+  fprintf(file, "\n]}\n");
+  const bool ok = fclose(file) == 0;
+
+  std::cout << "Trace " << events << " events written to " << path
+            << std::endl;
+  return ok;
+}
+
+}  // namespace
+
+std::atomic<bool> Trace::s_enabled{false};
+
+bool Trace::Initialize(const std::string& path) {
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGUSR1);
+  if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) != 0) {
+    std::cout << "Could not block SIGUSR1\n";
+    return false;
+  }
+  const int signal_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+  if (signal_fd < 0) {
+    std::cout << "signalfd() failed\n";
+    return false;
+  }
+
+  g_path = path;
+  g_initialized = true;
+  std::thread(HandleSignals, signal_fd).detach();
+
+  std::cout << "Trace to " << path << ", start and stop with kill -USR1 "
+            << getpid() << std::endl;
+  return true;
+}
+
+void Trace::HandleSignals(int signal_fd) {
+  signalfd_siginfo info;
+  while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+    if (s_enabled.exchange(false)) {
+      WriteTrace(g_path);
+      continue;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(g_mutex);
+      g_enabled_ns = Now();
+    }
+    s_enabled = true;
+    std::cout << "Trace started\n";
+  }
+}
+
+void Trace::Record(const char* name,
+                   int64_t begin_ns,
+                   int64_t end_ns,
+                   int64_t arg) {
+  // Scopes still open when tracing stopped must not write while the trace
+  // is being written
+  if (!IsEnabled()) {
+    return;
+  }
+
+  ThreadRing* ring = GetThreadRing();
+  const uint64_t count = ring->count.load(std::memory_order_relaxed);
+  ring->events[count % kRingSize] = {name, begin_ns, end_ns, arg};
+  ring->count.store(count + 1, std::memory_order_release);
+}
+
+void Trace::SetThreadName(const std::string& name) {
+  t_name = name;
+  if (!g_initialized) {
+    return;
+  }
+
+  // Also allocates the ring, keeping that off the first traced frame
+  ThreadRing* ring = GetThreadRing();
+  std::lock_guard<std::mutex> lock(g_mutex);
+  ring->name = name;
+}
+
+void Trace::Flush() {
+  if (s_enabled.exchange(false)) {
+    WriteTrace(g_path);
+  }
+}
@@ -0,0 +1,106 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <time.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Per-frame trace events, exported as Chrome trace JSON for chrome://tracing
+// or ui.perfetto.dev.
+//
+// Each thread writes complete events into its own ring buffer of the newest
+// 64K events, without locks or allocation. A disabled ScopedTrace costs one
+// relaxed load; an enabled one two clock reads and a store.
+//
+// Tracing is off until SIGUSR1 turns it on. The next SIGUSR1 turns it off
+// and writes the events recorded since to the file given to Initialize().
+class Trace {
+ public:
+  // Arms tracing to `path`. Blocks SIGUSR1 in the calling thread, so call it
+  // before any thread is created; a helper thread then handles the signal.
+  static bool Initialize(const std::string& path);
+
+  static bool IsEnabled() {
+    return s_enabled.load(std::memory_order_relaxed);
+  }
+
+  static int64_t Now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  // Records an event of the calling thread. `arg` is shown as the frame
+  // number unless negative.
+  static void Record(const char* name,
+                     int64_t begin_ns,
+                     int64_t end_ns,
+                     int64_t arg);
+
+  // Names the calling thread in the trace
+  static void SetThreadName(const std::string& name);
+
+  // Writes the trace if tracing is on, e.g. on exit
+  static void Flush();
+
+ private:
+  static void HandleSignals(int signal_fd);
+
+  static std::atomic<bool> s_enabled;
+};
+
+// Records the lifetime of a scope as an event. `name` must outlive the
+// trace, e.g. a string literal.
+class ScopedTrace {
+ public:
+  explicit ScopedTrace(const char* name, int64_t arg = -1)
+      : m_name(name),
+        m_arg(arg),
+        m_begin_ns(Trace::IsEnabled() ? Trace::Now() : 0) {}
+  ~ScopedTrace() {
+    if (m_begin_ns) {
+      Trace::Record(m_name, m_begin_ns, Trace::Now(), m_arg);
+    }
+  }
+
+  // Sets the frame number once it is known, e.g. after DQBUF
+  void SetArg(int64_t arg) { m_arg = arg; }
+
+ private:
+  const char* m_name;
+  int64_t m_arg;
+  int64_t m_begin_ns;
+};
+#endif /* __TRACE_H__ */
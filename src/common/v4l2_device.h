@@ -31,21 +31,232 @@
 #ifndef __V4L2_DEVICE_H__
 #define __V4L2_DEVICE_H__
 
+#include <atomic>
+#include <cerrno>
 #include <cstdint>
+#include <utility>
+
+#include <poll.h>
+
+#include "check.h"
 
 struct V4L2DeviceBuffer {
   uint32_t index;
 
   void* data;
   uint32_t len;
+
+  // CLOCK_MONOTONIC capture time in microseconds, zero if unknown. Set on an
+  // output buffer, it is passed on to the consumer (TIMESTAMP_COPY).
+  uint64_t timestamp_us;
+
+  // Driver frame sequence number of a dequeued capture buffer
+  uint32_t sequence;
+
+  // Bytes filled by the driver in a dequeued capture buffer, e.g. the size
+  // of a coded frame
+  uint32_t bytesused;
+
+  // Dmabuf backing the buffer, or -1. The fd stays owned by the device.
+  int fd = -1;
 };
 
+class V4L2Device;
+
+// Move-only handle to a dequeued buffer that queues the buffer back to its
+// device when destroyed or reset. Several leases can be held at once and
+// released in any order, from any thread. For an output device, releasing
+// a lease submits the buffer to the consumer.
+//
+// `Device` is V4L2Device, or a final device class whose Queue is then
+// called without a virtual call. A lease converts to one of a base class.
+template <typename Device>
+class BasicBufferLease {
+ public:
+  BasicBufferLease() = default;
+  BasicBufferLease(BasicBufferLease&& other) noexcept {
+    *this = std::move(other);
+  }
+  template <typename Other>
+  BasicBufferLease(BasicBufferLease<Other>&& other) noexcept {
+    *this = std::move(other);
+  }
+  ~BasicBufferLease() { Reset(); }
+
+  BasicBufferLease& operator=(BasicBufferLease&& other) noexcept {
+    return Assign(std::move(other));
+  }
+  template <typename Other>
+  BasicBufferLease& operator=(BasicBufferLease<Other>&& other) noexcept {
+    return Assign(std::move(other));
+  }
+
+  BasicBufferLease(const BasicBufferLease&) = delete;
+  BasicBufferLease& operator=(const BasicBufferLease&) = delete;
+
+  // False for an empty lease, e.g. from a lost device
+  explicit operator bool() const { return m_device != nullptr; }
+
+  V4L2DeviceBuffer& operator*() { return m_buffer; }
+  const V4L2DeviceBuffer& operator*() const { return m_buffer; }
+  V4L2DeviceBuffer* operator->() { return &m_buffer; }
+  const V4L2DeviceBuffer* operator->() const { return &m_buffer; }
+
+  // Returns the buffer to its device now
+  void Reset();
+
+ private:
+  template <typename>
+  friend class BasicBufferLease;
+  friend class V4L2Device;
+
+  BasicBufferLease(Device* device,
+                   const V4L2DeviceBuffer& buffer,
+                   uint64_t generation)
+      : m_device(device), m_buffer(buffer), m_generation(generation) {}
+
+  template <typename Other>
+  BasicBufferLease& Assign(BasicBufferLease<Other>&& other) {
+    if (static_cast<void*>(this) != static_cast<void*>(&other)) {
+      Reset();
+      m_device = std::exchange(other.m_device, nullptr);
+      m_buffer = other.m_buffer;
+      m_generation = other.m_generation;
+    }
+    return *this;
+  }
+
+  Device* m_device = nullptr;
+  V4L2DeviceBuffer m_buffer = {};
+  uint64_t m_generation = 0;
+};
+
+using BufferLease = BasicBufferLease<V4L2Device>;
+
 class V4L2Device {
  public:
+  // Every lease must be released first
+  virtual ~V4L2Device() { CHECK(m_lease_count == 0); }
+
   virtual void Initialize(int count) = 0;
   virtual void Start() = 0;
 
+  // Touches every page of the buffers so streaming does not page-fault.
+  // Call between Initialize and Start.
+  virtual void Prefault() = 0;
+
   virtual void Queue(V4L2DeviceBuffer device_buffer) = 0;
   virtual V4L2DeviceBuffer Dequeue() = 0;
+
+  virtual int GetFd() const = 0;
+
+  // Dequeues every ready buffer, requeues all but the newest and returns
+  // it, so a consumer that fell behind skips to the latest frame. Blocks
+  // like Dequeue until at least one buffer is ready. The number of frames
+  // skipped is added to `discarded`.
+  V4L2DeviceBuffer DequeueNewest(uint64_t* discarded) {
+    return DequeueNewest(this, discarded);
+  }
+
+  // Dequeue and DequeueNewest, wrapped in a lease that queues the buffer
+  // back. The lease is empty if the device is lost.
+  BufferLease Lease() { return MakeLease(this, Dequeue()); }
+  BufferLease LeaseNewest(uint64_t* discarded) {
+    return MakeLease(this, DequeueNewest(discarded));
+  }
+
+  // Number of leases not yet released
+  uint32_t GetLeaseCount() const { return m_lease_count; }
+
+  // Releases the buffers of a lost device so its fd can be closed.
+  virtual void Release() = 0;
+  // Resumes streaming on a reopened fd with the format already set, keeping
+  // user-side buffer allocations where possible. Buffers are prefaulted
+  // again if Prefault was called before.
+  virtual void Reopen(int fd) = 0;
+
+  // Set once the device was unplugged or reset by its driver. Queue and
+  // Dequeue are no-ops, and Dequeue returns an empty buffer, until Reopen.
+  bool IsLost() const { return m_lost; }
+
+ protected:
+  // DequeueNewest and Lease on `device` as its own type, for final device
+  // classes to call without virtual calls
+  template <typename Device>
+  static V4L2DeviceBuffer DequeueNewest(Device* device, uint64_t* discarded) {
+    V4L2DeviceBuffer newest = device->Dequeue();
+    while (!device->m_lost) {
+      pollfd pfd = {};
+      pfd.fd = device->GetFd();
+      pfd.events = POLLIN | POLLOUT;
+      if (poll(&pfd, 1, 0) <= 0 || !(pfd.revents & (POLLIN | POLLOUT))) {
+        break;
+      }
+
+      V4L2DeviceBuffer next = device->Dequeue();
+      if (device->m_lost) {
+        return next;
+      }
+      device->Queue(newest);
+      newest = next;
+      (*discarded)++;
+    }
+    return newest;
+  }
+
+  template <typename Device>
+  static BasicBufferLease<Device> MakeLease(Device* device,
+                                            const V4L2DeviceBuffer& buffer) {
+    V4L2Device* base = device;
+    if (base->m_lost) {
+      return {};
+    }
+    base->m_lease_count++;
+    return BasicBufferLease<Device>(device, buffer, base->m_lease_generation);
+  }
+
+  // Marks the device lost if `err` reports an unplug or driver reset, and
+  // returns whether it did. Any other error is a bug.
+  bool SetLost(int err) {
+    if (err != ENODEV && err != EIO) {
+      return false;
+    }
+
+    m_lost = true;
+    return true;
+  }
+
+  // Leases taken before a Release() no longer own a buffer; releasing them
+  // only updates the count. Call from Release().
+  void InvalidateLeases() { m_lease_generation++; }
+
+  std::atomic<bool> m_lost = false;
+
+ private:
+  template <typename>
+  friend class BasicBufferLease;
+
+  template <typename Device>
+  static void ReturnLease(Device* device,
+                          const V4L2DeviceBuffer& buffer,
+                          uint64_t generation) {
+    V4L2Device* base = device;
+    if (generation == base->m_lease_generation) {
+      device->Queue(buffer);
+    }
+    base->m_lease_count--;
+  }
+
+  std::atomic<uint32_t> m_lease_count = 0;
+  std::atomic<uint64_t> m_lease_generation = 0;
 };
+
+template <typename Device>
+inline void BasicBufferLease<Device>::Reset() {
+  if (m_device) {
+    V4L2Device::ReturnLease(std::exchange(m_device, nullptr), m_buffer,
+                            m_generation);
+  }
+}
+
 #endif /* __V4L2_DEVICE_H__ */
@@ -0,0 +1,326 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "startup_timer.h"
+#include "v4l2_device_cache.h"
+#include "v4l2_utils.h"
+
+// Splits a tab separated line, keeping empty fields
+static std::vector<std::string> split_fields(const std::string& line) {
+  std::vector<std::string> fields;
+  size_t begin = 0;
+  while (true) {
+    size_t end = line.find('\t', begin);
+    if (end == std::string::npos) {
+      fields.push_back(line.substr(begin));
+      break;
+    }
+    fields.push_back(line.substr(begin, end - begin));
+    begin = end + 1;
+  }
+  return fields;
+}
+
+V4L2DeviceCache::V4L2DeviceCache(const std::string& path) : m_path(path) {}
+
+std::string V4L2DeviceCache::GetDefaultPath() {
+  const char* cache_home = getenv("XDG_CACHE_HOME");
+  if (cache_home && cache_home[0]) {
+    return std::string(cache_home) + "/v4l2_camera/devices";
+  }
+
+  const char* home = getenv("HOME");
+  if (home && home[0]) {
+    return std::string(home) + "/.cache/v4l2_camera/devices";
+  }
+
+  return "/tmp/v4l2_camera/devices";
+}
+
+// Each device is a "device" line followed by its "format", "range" and
+// "size" lines; fields are tab separated.
+bool V4L2DeviceCache::Load() {
+  m_devices.clear();
+
+  std::ifstream file(m_path);
+  if (!file) {
+    return false;
+  }
+
+  try {
+    V4L2DeviceInfo* device = nullptr;
+    V4L2FormatInfo* format = nullptr;
+
+    std::string line;
+    while (std::getline(file, line)) {
+      std::vector<std::string> fields = split_fields(line);
+      if (line.empty()) {
+        continue;
+      }
+
+      if (fields[0] == "device" && fields.size() == 7) {
+        V4L2DeviceInfo info;
+        info.card = fields[1];
+        info.driver = fields[2];
+        info.bus_info = fields[3];
+        info.version = std::stoul(fields[4]);
+        info.capabilities = std::stoul(fields[5]);
+        info.memory_caps = std::stoul(fields[6]);
+        device = &(m_devices[info.GetCacheKey()] = info);
+        format = nullptr;
+      } else if (fields[0] == "format" && fields.size() == 4 && device) {
+        V4L2FormatInfo info;
+        info.pixelformat = std::stoul(fields[1]);
+        info.flags = std::stoul(fields[2]);
+        info.description = fields[3];
+        device->formats.push_back(info);
+        format = &device->formats.back();
+      } else if (fields[0] == "range" && fields.size() == 7 && format) {
+        format->has_range = true;
+        format->range.min_width = std::stoul(fields[1]);
+        format->range.max_width = std::stoul(fields[2]);
+        format->range.step_width = std::stoul(fields[3]);
+        format->range.min_height = std::stoul(fields[4]);
+        format->range.max_height = std::stoul(fields[5]);
+        format->range.step_height = std::stoul(fields[6]);
+      } else if (fields[0] == "size" && fields.size() >= 3 &&
+                 fields.size() % 2 == 1 && format) {
+        V4L2FrameSizeInfo size;
+        size.width = std::stoul(fields[1]);
+        size.height = std::stoul(fields[2]);
+        for (size_t i = 3; i < fields.size(); i += 2) {
+          size.intervals.push_back(
+              {uint32_t(std::stoul(fields[i])),
+               uint32_t(std::stoul(fields[i + 1]))});
+        }
+        format->sizes.push_back(size);
+      } else {
+        std::cout << "Invalid device cache " << m_path << std::endl;
+        m_devices.clear();
+        return false;
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cout << "Invalid device cache " << m_path << std::endl;
+    m_devices.clear();
+    return false;
+  }
+
+  return true;
+}
+
+bool V4L2DeviceCache::Save() const {
+  std::error_code ec;
+  std::filesystem::create_directories(
+      std::filesystem::path(m_path).parent_path(), ec);
+
+  // Write a private file and rename it so readers never see a partial cache
+  std::string tmp_path = m_path + "." + std::to_string(getpid());
+  {
+    std::ofstream file(tmp_path, std::ios::trunc);
+    if (!file) {
+      std::cout << "Unable to write device cache " << tmp_path << std::endl;
+      return false;
+    }
+
+    for (const auto& [key, device] : m_devices) {
+      file << "device\t" << device.card << "\t" << device.driver << "\t"
+           << device.bus_info << "\t" << device.version << "\t"
+           << device.capabilities << "\t" << device.memory_caps << "\n";
+
+      for (const V4L2FormatInfo& format : device.formats) {
+        file << "format\t" << format.pixelformat << "\t" << format.flags
+             << "\t" << format.description << "\n";
+
+        if (format.has_range) {
+          const v4l2_frmsize_stepwise& range = format.range;
+          file << "range\t" << range.min_width << "\t" << range.max_width
+               << "\t" << range.step_width << "\t" << range.min_height << "\t"
+               << range.max_height << "\t" << range.step_height << "\n";
+        }
+
+        for (const V4L2FrameSizeInfo& size : format.sizes) {
+          file << "size\t" << size.width << "\t" << size.height;
+          for (const v4l2_fract& interval : size.intervals) {
+            file << "\t" << interval.numerator << "\t"
+                 << interval.denominator;
+          }
+          file << "\n";
+        }
+      }
+    }
+
+    if (!file.flush()) {
+      std::filesystem::remove(tmp_path, ec);
+      return false;
+    }
+  }
+
+  std::filesystem::rename(tmp_path, m_path, ec);
+  if (ec) {
+    std::cout << "Unable to write device cache " << m_path << std::endl;
+    std::filesystem::remove(tmp_path, ec);
+    return false;
+  }
+
+  return true;
+}
+
+const V4L2DeviceInfo* V4L2DeviceCache::Find(const std::string& key) const {
+  auto it = m_devices.find(key);
+  return it != m_devices.end() ? &it->second : nullptr;
+}
+
+void V4L2DeviceCache::Update(const V4L2DeviceInfo& info) {
+  V4L2DeviceInfo& device = m_devices[info.GetCacheKey()] = info;
+  // Paths are not stable across boots
+  device.path.clear();
+}
+
+// The formats of a v4l2loopback device are whatever its producer set last,
+// so they are enumerated every time rather than cached
+static bool is_producer_defined(const V4L2DeviceInfo& capability) {
+  return capability.driver == "v4l2 loopback";
+}
+
+// Checks `width` x `height` against the frame sizes the device enumerates
+// for `pixelformat` right now. A device that enumerates none leaves it to
+// S_FMT.
+static bool is_frame_size_supported(int fd,
+                                    uint32_t pixelformat,
+                                    uint32_t width,
+                                    uint32_t height) {
+  auto fits = [](uint32_t value, uint32_t min, uint32_t max, uint32_t step) {
+    return value >= min && value <= max &&
+           (step <= 1 || (value - min) % step == 0);
+  };
+
+  v4l2_frmsizeenum vfse = {};
+  vfse.pixel_format = pixelformat;
+  for (; ioctl(fd, VIDIOC_ENUM_FRAMESIZES, &vfse) == 0; vfse.index++) {
+    if (vfse.type != V4L2_FRMSIZE_TYPE_DISCRETE) {
+      const v4l2_frmsize_stepwise& range = vfse.stepwise;
+      return fits(width, range.min_width, range.max_width,
+                  range.step_width) &&
+             fits(height, range.min_height, range.max_height,
+                  range.step_height);
+    }
+    if (vfse.discrete.width == width && vfse.discrete.height == height) {
+      return true;
+    }
+  }
+  return vfse.index == 0;
+}
+
+// Enumerates the device and replaces its cache entry
+static bool update_cached_device_info(int fd,
+                                      V4L2DeviceCache* cache,
+                                      V4L2DeviceInfo* info) {
+  if (!v4l2_query_device_info(fd, info)) {
+    return false;
+  }
+
+  cache->Update(*info);
+  cache->Save();
+  return true;
+}
+
+bool v4l2_get_cached_device_info(int fd, V4L2DeviceInfo* info) {
+  V4L2DeviceInfo capability;
+  if (!v4l2_query_capability(fd, &capability)) {
+    return false;
+  }
+
+  if (is_producer_defined(capability)) {
+    std::cout << "Device cache skipped: " << capability.driver << std::endl;
+    return v4l2_query_device_info(fd, info);
+  }
+
+  V4L2DeviceCache cache;
+  cache.Load();
+  if (const V4L2DeviceInfo* cached = cache.Find(capability.GetCacheKey())) {
+    std::cout << "Device cache hit: " << capability.bus_info << std::endl;
+    *info = *cached;
+    return true;
+  }
+
+  std::cout << "Device cache miss: " << capability.bus_info << std::endl;
+  return update_cached_device_info(fd, &cache, info);
+}
+
+bool v4l2_select_capture_mode(int fd,
+                              uint32_t pixelformat,
+                              uint32_t* width,
+                              uint32_t* height) {
+  ScopedStartupTimer timer("capture mode selection");
+
+  V4L2DeviceInfo info;
+  if (!v4l2_get_cached_device_info(fd, &info) || info.formats.empty()) {
+    // Nothing known about the device, leave it to S_FMT
+    return true;
+  }
+
+  uint32_t found_width = *width;
+  uint32_t found_height = *height;
+  if (!v4l2_find_frame_size(info, pixelformat, &found_width, &found_height)) {
+    std::cout << "pixelformat not supported "
+              << v4l2_fourcc_to_string(pixelformat) << std::endl;
+    return false;
+  }
+
+  // A cached size the device no longer offers means the entry is stale:
+  // refresh it for the next run and negotiate the requested size with S_FMT
+  if (!is_frame_size_supported(fd, pixelformat, found_width, found_height)) {
+    std::cout << "Device cache stale: " << found_width << "x" << found_height
+              << " no longer supported" << std::endl;
+    V4L2DeviceCache cache;
+    cache.Load();
+    update_cached_device_info(fd, &cache, &info);
+    return true;
+  }
+
+  if (found_width != *width || found_height != *height) {
+    std::cout << "Video Size not supported " << *width << "x" << *height
+              << ", use " << found_width << "x" << found_height << std::endl;
+    *width = found_width;
+    *height = found_height;
+  }
+
+  return true;
+}
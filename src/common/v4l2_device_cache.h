@@ -0,0 +1,74 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __V4L2_DEVICE_CACHE_H__
+#define __V4L2_DEVICE_CACHE_H__
+
+#include <map>
+#include <string>
+
+#include "v4l2_device_info.h"
+
+// On-disk cache of enumerated device capabilities, keyed by bus_info, driver
+// and driver version, so apps can pick a mode without re-enumerating.
+class V4L2DeviceCache {
+ public:
+  explicit V4L2DeviceCache(const std::string& path = GetDefaultPath());
+
+  // $XDG_CACHE_HOME/v4l2_camera/devices, or ~/.cache/v4l2_camera/devices
+  static std::string GetDefaultPath();
+
+  bool Load();
+  bool Save() const;
+
+  const V4L2DeviceInfo* Find(const std::string& key) const;
+  void Update(const V4L2DeviceInfo& info);
+
+ private:
+  std::string m_path;
+
+  std::map<std::string, V4L2DeviceInfo> m_devices;
+};
+
+// Returns the capabilities of an opened device from the default cache,
+// enumerating and caching them on a miss. v4l2loopback devices, whose
+// formats follow their producer, are always enumerated and never cached.
+bool v4l2_get_cached_device_info(int fd, V4L2DeviceInfo* info);
+
+// Picks the capture frame size closest to `width` x `height` from the cached
+// capabilities so S_FMT succeeds on the first try. The pick is checked
+// against the sizes the device enumerates now; if it is gone, the cache
+// entry is refreshed and the requested size is left to S_FMT. Returns false
+// if the device is known not to support `pixelformat`.
+bool v4l2_select_capture_mode(int fd,
+                              uint32_t pixelformat,
+                              uint32_t* width,
+                              uint32_t* height);
+#endif /* __V4L2_DEVICE_CACHE_H__ */
@@ -0,0 +1,241 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <optional>
+
+#include "v4l2_device_info.h"
+#include "v4l2_utils.h"
+
+std::string V4L2DeviceInfo::GetCacheKey() const {
+  return bus_info + "|" + driver + "|" + std::to_string(version) + "|" + card;
+}
+
+static void query_frame_sizes(int fd, V4L2FormatInfo* format) {
+  v4l2_frmsizeenum vfse = {};
+  vfse.pixel_format = format->pixelformat;
+
+  while (!ioctl(fd, VIDIOC_ENUM_FRAMESIZES, &vfse)) {
+    switch (vfse.type) {
+      case V4L2_FRMSIZE_TYPE_DISCRETE: {
+        V4L2FrameSizeInfo size = {};
+        size.width = vfse.discrete.width;
+        size.height = vfse.discrete.height;
+        size.intervals = v4l2_get_frame_intervals(fd, format->pixelformat,
+                                                  size.width, size.height);
+        format->sizes.push_back(size);
+        break;
+      }
+      case V4L2_FRMSIZE_TYPE_CONTINUOUS:
+      case V4L2_FRMSIZE_TYPE_STEPWISE:
+        format->has_range = true;
+        format->range = vfse.stepwise;
+        break;
+    }
+    vfse.index++;
+  }
+}
+
+static uint32_t query_memory_caps(int fd) {
+  // Since Linux 4.20 a zero-count REQBUFS reports the supported memory types
+  // without allocating anything.
+  v4l2_requestbuffers reqbuf = {};
+  reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  reqbuf.memory = V4L2_MEMORY_MMAP;
+  reqbuf.count = 0;
+  if (ioctl(fd, VIDIOC_REQBUFS, &reqbuf) == 0 && reqbuf.capabilities) {
+    return reqbuf.capabilities &
+           (V4L2_BUF_CAP_SUPPORTS_MMAP | V4L2_BUF_CAP_SUPPORTS_USERPTR |
+            V4L2_BUF_CAP_SUPPORTS_DMABUF);
+  }
+
+  // Older kernels: probe each memory type and release the buffer again
+  const std::pair<uint32_t, uint32_t> memory_types[] = {
+      {V4L2_MEMORY_MMAP, V4L2_BUF_CAP_SUPPORTS_MMAP},
+      {V4L2_MEMORY_USERPTR, V4L2_BUF_CAP_SUPPORTS_USERPTR},
+      {V4L2_MEMORY_DMABUF, V4L2_BUF_CAP_SUPPORTS_DMABUF}};
+
+  uint32_t memory_caps = 0;
+  for (const auto& [memory, cap] : memory_types) {
+    reqbuf = {};
+    reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    reqbuf.memory = memory;
+    reqbuf.count = 1;
+    if (ioctl(fd, VIDIOC_REQBUFS, &reqbuf) == 0) {
+      memory_caps |= cap;
+
+      reqbuf.count = 0;
+      ioctl(fd, VIDIOC_REQBUFS, &reqbuf);
+    }
+  }
+
+  return memory_caps;
+}
+
+bool v4l2_query_capability(int fd, V4L2DeviceInfo* info) {
+  v4l2_capability cap = {};
+  if (ioctl(fd, VIDIOC_QUERYCAP, &cap) < 0) {
+    std::cout << "ioctl(VIDIOC_QUERYCAP) failed\n";
+    return false;
+  }
+
+  info->card = reinterpret_cast<const char*>(cap.card);
+  info->driver = reinterpret_cast<const char*>(cap.driver);
+  info->bus_info = reinterpret_cast<const char*>(cap.bus_info);
+  info->version = cap.version;
+  info->capabilities = (cap.capabilities & V4L2_CAP_DEVICE_CAPS)
+                           ? cap.device_caps
+                           : cap.capabilities;
+  return true;
+}
+
+bool v4l2_query_device_info(int fd, V4L2DeviceInfo* info) {
+  if (!v4l2_query_capability(fd, info)) {
+    return false;
+  }
+
+  info->formats.clear();
+  if (info->capabilities & V4L2_CAP_VIDEO_CAPTURE) {
+    v4l2_fmtdesc vfd = {};
+    vfd.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    while (!ioctl(fd, VIDIOC_ENUM_FMT, &vfd)) {
+      V4L2FormatInfo format;
+      format.pixelformat = vfd.pixelformat;
+      format.flags = vfd.flags;
+      format.description = reinterpret_cast<const char*>(vfd.description);
+      query_frame_sizes(fd, &format);
+      info->formats.push_back(format);
+
+      vfd.index++;
+    }
+  }
+
+  info->memory_caps = query_memory_caps(fd);
+  return true;
+}
+
+std::vector<V4L2DeviceInfo> v4l2_query_devices(
+    const std::vector<std::string>& paths) {
+  std::vector<std::future<std::optional<V4L2DeviceInfo>>> futures;
+  for (const std::string& path : paths) {
+    futures.push_back(std::async(
+        std::launch::async, [path]() -> std::optional<V4L2DeviceInfo> {
+          int fd = open(path.c_str(), O_RDWR);
+          if (fd < 0) {
+            return std::nullopt;
+          }
+
+          V4L2DeviceInfo info;
+          info.path = path;
+          bool ok = v4l2_query_device_info(fd, &info);
+          close(fd);
+
+          if (!ok) {
+            return std::nullopt;
+          }
+          return info;
+        }));
+  }
+
+  std::vector<V4L2DeviceInfo> devices;
+  for (auto& future : futures) {
+    std::optional<V4L2DeviceInfo> info = future.get();
+    if (info) {
+      devices.push_back(*info);
+    }
+  }
+
+  return devices;
+}
+
+bool v4l2_find_frame_size(const V4L2DeviceInfo& info,
+                          uint32_t pixelformat,
+                          uint32_t* width,
+                          uint32_t* height) {
+  auto format = std::find_if(
+      info.formats.begin(), info.formats.end(),
+      [&](const V4L2FormatInfo& f) { return f.pixelformat == pixelformat; });
+  if (format == info.formats.end()) {
+    return false;
+  }
+
+  auto distance = [&](uint32_t w, uint32_t h) {
+    return std::abs(int64_t(w) - *width) + std::abs(int64_t(h) - *height);
+  };
+
+  bool found = false;
+  uint32_t best_width = 0;
+  uint32_t best_height = 0;
+  for (const V4L2FrameSizeInfo& size : format->sizes) {
+    if (!found || distance(size.width, size.height) <
+                      distance(best_width, best_height)) {
+      found = true;
+      best_width = size.width;
+      best_height = size.height;
+    }
+  }
+
+  if (format->has_range) {
+    const v4l2_frmsize_stepwise& range = format->range;
+    auto fit = [](uint32_t value, uint32_t min, uint32_t max, uint32_t step) {
+      value = std::clamp(value, min, max);
+      if (step > 1) {
+        value = min + (value - min) / step * step;
+      }
+      return value;
+    };
+
+    uint32_t w =
+        fit(*width, range.min_width, range.max_width, range.step_width);
+    uint32_t h =
+        fit(*height, range.min_height, range.max_height, range.step_height);
+    if (!found || distance(w, h) < distance(best_width, best_height)) {
+      found = true;
+      best_width = w;
+      best_height = h;
+    }
+  }
+
+  if (!found) {
+    return false;
+  }
+
+  *width = best_width;
+  *height = best_height;
+  return true;
+}
@@ -0,0 +1,98 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __V4L2_DEVICE_INFO_H__
+#define __V4L2_DEVICE_INFO_H__
+
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+#include <linux/videodev2.h>
+
+struct V4L2FrameSizeInfo {
+  uint32_t width;
+  uint32_t height;
+
+  std::vector<v4l2_fract> intervals;
+};
+
+struct V4L2FormatInfo {
+  uint32_t pixelformat = 0;
+  uint32_t flags = 0;
+  std::string description;
+
+  // Discrete frame sizes
+  std::vector<V4L2FrameSizeInfo> sizes;
+
+  // Stepwise or continuous frame size range
+  bool has_range = false;
+  v4l2_frmsize_stepwise range = {};
+};
+
+struct V4L2DeviceInfo {
+  std::string path;
+
+  std::string card;
+  std::string driver;
+  std::string bus_info;
+  uint32_t version = 0;
+  uint32_t capabilities = 0;
+
+  // V4L2_BUF_CAP_SUPPORTS_* of the capture queue
+  uint32_t memory_caps = 0;
+
+  // Capture formats
+  std::vector<V4L2FormatInfo> formats;
+
+  // Identifies the same physical device and driver across runs
+  std::string GetCacheKey() const;
+};
+
+// Fills the VIDIOC_QUERYCAP part of `info` only.
+bool v4l2_query_capability(int fd, V4L2DeviceInfo* info);
+
+// Fills `info` with the capabilities, capture formats, frame sizes, frame
+// intervals and memory types of the device.
+bool v4l2_query_device_info(int fd, V4L2DeviceInfo* info);
+
+// Enumerates the given device nodes in parallel. Nodes that cannot be opened
+// or queried are skipped.
+std::vector<V4L2DeviceInfo> v4l2_query_devices(
+    const std::vector<std::string>& paths);
+
+// Adjusts `width` x `height` to the closest frame size `info` supports for
+// `pixelformat`. Returns false if the pixel format is not supported.
+bool v4l2_find_frame_size(const V4L2DeviceInfo& info,
+                          uint32_t pixelformat,
+                          uint32_t* width,
+                          uint32_t* height);
+#endif /* __V4L2_DEVICE_INFO_H__ */
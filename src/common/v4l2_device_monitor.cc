@@ -0,0 +1,158 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "v4l2_device_monitor.h"
+
+// Opens `path` if it is a node of the device identified by `bus_info`
+static int open_matching_device(const std::string& path,
+                                const std::string& bus_info,
+                                uint32_t capability) {
+  int fd = open(path.c_str(), O_RDWR);
+  if (fd < 0) {
+    return -1;
+  }
+
+  v4l2_capability cap = {};
+  if (ioctl(fd, VIDIOC_QUERYCAP, &cap) == 0) {
+    const uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS)
+                              ? cap.device_caps
+                              : cap.capabilities;
+    if (bus_info == reinterpret_cast<const char*>(cap.bus_info) &&
+        (caps & capability)) {
+      return fd;
+    }
+  }
+
+  close(fd);
+  return -1;
+}
+
+V4L2DeviceMonitor::V4L2DeviceMonitor() {
+  m_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                NETLINK_KOBJECT_UEVENT);
+  if (m_fd < 0) {
+    std::cout << "Unable to watch uevents, polling for devices\n";
+    return;
+  }
+
+  // Group 1 carries the kernel's own uevents
+  sockaddr_nl addr = {};
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = 1;
+  if (bind(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    std::cout << "Unable to watch uevents, polling for devices\n";
+    close(m_fd);
+    m_fd = -1;
+  }
+}
+
+V4L2DeviceMonitor::~V4L2DeviceMonitor() {
+  if (m_fd >= 0) {
+    close(m_fd);
+    m_fd = -1;
+  }
+}
+
+void V4L2DeviceMonitor::ReadEvents() {
+  char buf[4096];
+  ssize_t len;
+  while ((len = recv(m_fd, buf, sizeof(buf) - 1, 0)) > 0) {
+    buf[len] = '\0';
+
+    // "ACTION@DEVPATH" followed by NUL separated KEY=VALUE pairs
+    bool add = false;
+    bool video4linux = false;
+    std::string devname;
+    for (const char* p = buf; p < buf + len; p += strlen(p) + 1) {
+      if (!strcmp(p, "ACTION=add")) {
+        add = true;
+      } else if (!strcmp(p, "SUBSYSTEM=video4linux")) {
+        video4linux = true;
+      } else if (!strncmp(p, "DEVNAME=", 8)) {
+        devname = p + 8;
+      }
+    }
+
+    if (add && video4linux && !devname.empty()) {
+      std::string path =
+          devname[0] == '/' ? devname : std::string("/dev/") + devname;
+      if (std::find(m_pending.begin(), m_pending.end(), path) ==
+          m_pending.end()) {
+        std::cout << "Device added: " << path << std::endl;
+        m_pending.push_back(path);
+      }
+    }
+  }
+}
+
+int V4L2DeviceMonitor::WaitForDevice(const std::string& path,
+                                     const std::string& bus_info,
+                                     uint32_t capability,
+                                     int timeout_ms) {
+  // The node may survive a driver reset
+  int fd = open_matching_device(path, bus_info, capability);
+  if (fd >= 0) {
+    return fd;
+  }
+
+  if (m_fd < 0) {
+    poll(nullptr, 0, timeout_ms);
+    return -1;
+  }
+
+  pollfd pfd = {};
+  pfd.fd = m_fd;
+  pfd.events = POLLIN;
+  if (poll(&pfd, 1, timeout_ms) > 0) {
+    ReadEvents();
+  }
+
+  for (const std::string& pending : m_pending) {
+    fd = open_matching_device(pending, bus_info, capability);
+    if (fd >= 0) {
+      m_pending.clear();
+      return fd;
+    }
+  }
+
+  return -1;
+}
@@ -28,29 +28,38 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
-#ifndef __OUTPUT_DEVICE_MMAP_H__
-#define __OUTPUT_DEVICE_MMAP_H__
+#ifndef __V4L2_DEVICE_MONITOR_H__
+#define __V4L2_DEVICE_MONITOR_H__
 
-#include <vector>
+#include <cstdint>
 
-#include "v4l2_device.h"
+#include <string>
+#include <vector>
 
-class OutputDeviceMmap : public V4L2Device {
+// Watches kernel uevents for video4linux nodes to find a device again after
+// it was unplugged or reset by its driver. Devices are matched by bus_info,
+// since a replugged camera may come back under a different /dev/videoN.
+class V4L2DeviceMonitor {
  public:
-  OutputDeviceMmap(int fd, int width, int height);
-  ~OutputDeviceMmap();
+  V4L2DeviceMonitor();
+  ~V4L2DeviceMonitor();
 
-  void Initialize(int buffer_count) override;
-  void Start() override;
-
-  void Queue(V4L2DeviceBuffer device_buffer) override;
-  V4L2DeviceBuffer Dequeue() override;
+  // Waits up to `timeout_ms` for a node with `bus_info` and `capability`
+  // (V4L2_CAP_*) to appear, trying `path` first. Returns the opened fd, or
+  // -1 if the device is not back yet.
+  int WaitForDevice(const std::string& path,
+                    const std::string& bus_info,
+                    uint32_t capability,
+                    int timeout_ms);
 
  private:
-  int m_fd;
-  int m_width;
-  int m_height;
+  // Collects the /dev nodes of added video4linux devices
+  void ReadEvents();
+
+  int m_fd = -1;
 
-  std::vector<V4L2DeviceBuffer> m_device_buffers;
+  // Nodes announced but not opened yet, e.g. while udev still applies
+  // permissions
+  std::vector<std::string> m_pending;
 };
-#endif /* __OUTPUT_DEVICE_MMAP_H__ */
+#endif /* __V4L2_DEVICE_MONITOR_H__ */
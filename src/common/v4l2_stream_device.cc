@@ -0,0 +1,105 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "v4l2_stream_device.h"
+
+// Tries each alternative of `Ref` in turn
+template <typename Ref, size_t I = 0>
+static Ref get_device(V4L2Device* device) {
+  using Device = std::remove_pointer_t<std::variant_alternative_t<I, Ref>>;
+  if (Device* concrete = dynamic_cast<Device*>(device)) {
+    return concrete;
+  }
+  if constexpr (I + 1 < std::variant_size_v<Ref>) {
+    return get_device<Ref, I + 1>(device);
+  } else {
+    CHECK(0);
+    return {};
+  }
+}
+
+bool v4l2_parse_memory_type(const std::string& name, V4L2MemoryType* type) {
+  if (name == "mmap") {
+    *type = V4L2MemoryType::kMmap;
+  } else if (name == "expbuf") {
+    *type = V4L2MemoryType::kExpbuf;
+  } else if (name == "dmabuf") {
+    *type = V4L2MemoryType::kDmabuf;
+  } else if (name == "userptr") {
+    *type = V4L2MemoryType::kUserptr;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<V4L2Device> v4l2_create_capture_device(V4L2MemoryType type,
+                                                       int fd,
+                                                       int width,
+                                                       int height) {
+  switch (type) {
+    case V4L2MemoryType::kMmap:
+      return std::make_unique<CaptureDeviceMmap>(fd, width, height);
+    case V4L2MemoryType::kExpbuf:
+      return std::make_unique<CaptureDeviceExpbuf>(fd, width, height);
+    case V4L2MemoryType::kDmabuf:
+      return std::make_unique<CaptureDeviceDmabuf>(fd, width, height);
+    case V4L2MemoryType::kUserptr:
+      return std::make_unique<CaptureDeviceUserptr>(fd, width, height);
+  }
+  CHECK(0);
+  return nullptr;
+}
+
+std::unique_ptr<V4L2Device> v4l2_create_output_device(V4L2MemoryType type,
+                                                      int fd,
+                                                      int width,
+                                                      int height) {
+  switch (type) {
+    case V4L2MemoryType::kMmap:
+      return std::make_unique<OutputDeviceMmap>(fd, width, height);
+    case V4L2MemoryType::kExpbuf:
+      return std::make_unique<OutputDeviceExpbuf>(fd, width, height);
+    case V4L2MemoryType::kDmabuf:
+      return std::make_unique<OutputDeviceDmabuf>(fd, width, height);
+    case V4L2MemoryType::kUserptr:
+      return std::make_unique<OutputDeviceUserptr>(fd, width, height);
+  }
+  CHECK(0);
+  return nullptr;
+}
+
+CaptureDeviceRef v4l2_get_capture_device(V4L2Device* device) {
+  return get_device<CaptureDeviceRef>(device);
+}
+
+OutputDeviceRef v4l2_get_output_device(V4L2Device* device) {
+  return get_device<OutputDeviceRef>(device);
+}
@@ -0,0 +1,639 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __V4L2_STREAM_DEVICE_H__
+#define __V4L2_STREAM_DEVICE_H__
+
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "check.h"
+#include "drm_prime_dmabuf.h"
+#include "logger.h"
+#include "rt_utils.h"
+#include "startup_timer.h"
+#include "trace.h"
+#include "v4l2_device.h"
+#include "v4l2_utils.h"
+
+// A streaming V4L2 queue assembled from three policies fixed at compile
+// time:
+//
+//   Direction     CaptureDirection, OutputDirection or M2MOutputDirection
+//   MemoryPolicy  MmapMemory, ExpbufMemory, DmabufMemory, UserptrMemory or
+//                 ImportMemory
+//   PlanePolicy   SinglePlane
+//
+// Queue and Dequeue are inlined with the policy calls, so the per-frame
+// path has no branch or call on the memory type. Apps create a device for
+// the memory type chosen at run time, then visit it once as its own type,
+// see v4l2_get_capture_device, and stream without virtual calls.
+
+struct CaptureDirection {
+  static constexpr bool kIsOutput = false;
+  static constexpr v4l2_buf_type kType = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  static constexpr short kPollEvents = POLLIN;
+  static constexpr const char* kName = "capture";
+  static constexpr const char* kDequeueTrace = "capture DQBUF";
+  static constexpr const char* kQueueTrace = "capture QBUF";
+  static constexpr bool kPrequeue = true;
+};
+
+struct OutputDirection {
+  static constexpr bool kIsOutput = true;
+  static constexpr v4l2_buf_type kType = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+  static constexpr short kPollEvents = POLLOUT;
+  static constexpr const char* kName = "output";
+  static constexpr const char* kDequeueTrace = "output DQBUF";
+  static constexpr const char* kQueueTrace = "output QBUF";
+  static constexpr bool kPrequeue = true;
+};
+
+// OUTPUT queue of a mem2mem device. It starts empty: frames are queued as
+// they arrive and dequeued again once the device has consumed them, so
+// Start does not queue blank buffers.
+struct M2MOutputDirection : OutputDirection {
+  static constexpr bool kPrequeue = false;
+};
+
+// Single-planar API, the plane is described by v4l2_buffer itself
+struct SinglePlane {
+  static constexpr v4l2_buf_type BufType(v4l2_buf_type type) { return type; }
+
+  class Buffer {
+   public:
+    Buffer(v4l2_buf_type type, v4l2_memory memory) {
+      m_buf.type = type;
+      m_buf.memory = memory;
+    }
+
+    v4l2_buffer* Get() { return &m_buf; }
+
+    uint32_t GetLength() const { return m_buf.length; }
+    uint32_t GetOffset() const { return m_buf.m.offset; }
+    uint32_t GetBytesUsed() const { return m_buf.bytesused; }
+
+    void SetBytesUsed(uint32_t bytesused) { m_buf.bytesused = bytesused; }
+    void SetLength(uint32_t length) { m_buf.length = length; }
+    void SetFd(int fd) { m_buf.m.fd = fd; }
+    void SetUserptr(void* data) { m_buf.m.userptr = (unsigned long)data; }
+
+   private:
+    v4l2_buffer m_buf = {};
+  };
+};
+
+// Memory policies. Allocate sets up a buffer after QUERYBUF and maps it in
+// `data` for the CPU, Prepare fills the QBUF arguments for the `queued`
+// buffer, and Release undoes Allocate for a lost device. Errors are
+// returned as an errno.
+
+// Driver buffers mapped once for the lifetime of the queue
+template <typename Direction>
+class MmapMemory {
+ public:
+  static constexpr v4l2_memory kMemory = V4L2_MEMORY_MMAP;
+  static constexpr const char* kName = "mmap";
+
+  template <typename Buffer>
+  int Allocate(int fd, Buffer& v4l2_buf, V4L2DeviceBuffer* device_buffer) {
+    device_buffer->len = v4l2_buf.GetLength();
+    device_buffer->data =
+        mmap(nullptr, device_buffer->len, PROT_READ | PROT_WRITE, MAP_SHARED,
+             fd, v4l2_buf.GetOffset());
+    if (device_buffer->data == MAP_FAILED) {
+      device_buffer->data = nullptr;
+      return errno;
+    }
+    return 0;
+  }
+
+  void Prefault(const V4L2DeviceBuffer& device_buffer) {
+    rt_prefault(device_buffer.data, device_buffer.len, true);
+  }
+
+  template <typename Buffer>
+  void Prepare(V4L2DeviceBuffer*, const V4L2DeviceBuffer&, Buffer&) {}
+
+  void Release(V4L2DeviceBuffer* device_buffer) {
+    if (device_buffer->data) {
+      munmap(device_buffer->data, device_buffer->len);
+      device_buffer->data = nullptr;
+    }
+  }
+};
+
+// Driver buffers exported with EXPBUF and mapped once through the dmabuf,
+// as a dmabuf importer would see them
+template <typename Direction>
+class ExpbufMemory {
+ public:
+  static constexpr v4l2_memory kMemory = V4L2_MEMORY_MMAP;
+  static constexpr const char* kName = "expbuf";
+
+  template <typename Buffer>
+  int Allocate(int fd, Buffer& v4l2_buf, V4L2DeviceBuffer* device_buffer) {
+    v4l2_exportbuffer expbuf = {};
+    expbuf.type = v4l2_buf.Get()->type;
+    expbuf.index = device_buffer->index;
+    expbuf.flags = O_CLOEXEC | (Direction::kIsOutput ? O_RDWR : O_RDONLY);
+    if (ioctl(fd, VIDIOC_EXPBUF, &expbuf) == -1) {
+      const int err = errno;
+      Log(LogLevel::kError) << "ioctl(VIDIOC_EXPBUF) failed";
+      return err;
+    }
+
+    constexpr int kProt =
+        Direction::kIsOutput ? PROT_READ | PROT_WRITE : PROT_READ;
+    device_buffer->len = v4l2_buf.GetLength();
+    device_buffer->data = mmap(nullptr, device_buffer->len, kProt, MAP_SHARED,
+                               expbuf.fd, 0);
+    if (device_buffer->data == MAP_FAILED) {
+      const int err = errno;
+      Log(LogLevel::kError) << "Mapping exported buffer failed";
+      close(expbuf.fd);
+      device_buffer->data = nullptr;
+      return err;
+    }
+    device_buffer->fd = expbuf.fd;
+    return 0;
+  }
+
+  void Prefault(const V4L2DeviceBuffer& device_buffer) {
+    rt_prefault(device_buffer.data, device_buffer.len, Direction::kIsOutput);
+  }
+
+  template <typename Buffer>
+  void Prepare(V4L2DeviceBuffer*, const V4L2DeviceBuffer&, Buffer&) {}
+
+  void Release(V4L2DeviceBuffer* device_buffer) {
+    if (device_buffer->data) {
+      munmap(device_buffer->data, device_buffer->len);
+      device_buffer->data = nullptr;
+    }
+    if (device_buffer->fd >= 0) {
+      close(device_buffer->fd);
+      device_buffer->fd = -1;
+    }
+  }
+};
+
+// DRM dumb buffers imported by the driver. They are kept across a Reopen
+// and reused when still large enough.
+template <typename Direction>
+class DmabufMemory {
+ public:
+  static constexpr v4l2_memory kMemory = V4L2_MEMORY_DMABUF;
+  static constexpr const char* kName = "dmabuf";
+
+  template <typename Buffer>
+  int Allocate(int, Buffer& v4l2_buf, V4L2DeviceBuffer* device_buffer) {
+    if (m_drm_fd < 0) {
+      ScopedStartupTimer timer(std::string(Direction::kName) + " DRM open");
+      m_drm_fd = DrmPrimeDmabuf::OpenDrm("/dev/dri/renderD128");
+    }
+    CHECK(m_drm_fd > 0);
+
+    const uint32_t i = device_buffer->index;
+    const uint32_t length = v4l2_buf.GetLength();
+    if (i >= m_dmabufs.size() || m_dmabufs[i]->m_size < length) {
+      ScopedStartupTimer timer(std::string(Direction::kName) +
+                               " dmabuf allocation");
+      auto dmabuf = std::make_shared<DrmPrimeDmabuf>(m_drm_fd, length);
+      CHECK(dmabuf->m_size >= length);
+
+      if (i < m_dmabufs.size()) {
+        m_dmabufs[i] = dmabuf;
+      } else {
+        m_dmabufs.push_back(dmabuf);
+      }
+    }
+
+    device_buffer->len = m_dmabufs[i]->m_size;
+    device_buffer->data = m_dmabufs[i]->Map(m_dmabufs[i]->m_size);
+    if (!device_buffer->data) {
+      const int err = errno;
+      Log(LogLevel::kError) << "Mapping dmabuf failed";
+      return err;
+    }
+    device_buffer->fd = m_dmabufs[i]->m_fd;
+
+    Log(LogLevel::kInfo) << "dmabuf fd " << m_dmabufs[i]->m_fd;
+    return 0;
+  }
+
+  void Prefault(const V4L2DeviceBuffer& device_buffer) {
+    rt_prefault(device_buffer.data, device_buffer.len, true);
+  }
+
+  template <typename Buffer>
+  void Prepare(V4L2DeviceBuffer* device_buffer,
+               const V4L2DeviceBuffer&,
+               Buffer& v4l2_buf) {
+    const DrmPrimeDmabuf* dmabuf = m_dmabufs[device_buffer->index].get();
+    v4l2_buf.SetFd(dmabuf->m_fd);
+    v4l2_buf.SetLength(dmabuf->m_size);
+  }
+
+  void Release(V4L2DeviceBuffer* device_buffer) {
+    if (device_buffer->data) {
+      m_dmabufs[device_buffer->index]->Unmap(device_buffer->data);
+      device_buffer->data = nullptr;
+    }
+  }
+
+ private:
+  int m_drm_fd = -1;
+  std::vector<std::shared_ptr<DrmPrimeDmabuf>> m_dmabufs;
+};
+
+// Page-aligned heap buffers passed by address. They are kept across a
+// Reopen and reused when still large enough.
+template <typename Direction>
+class UserptrMemory {
+ public:
+  static constexpr v4l2_memory kMemory = V4L2_MEMORY_USERPTR;
+  static constexpr const char* kName = "userptr";
+
+  ~UserptrMemory() {
+    for (const Allocation& allocation : m_allocations) {
+      free(allocation.data);
+    }
+  }
+
+  template <typename Buffer>
+  int Allocate(int, Buffer& v4l2_buf, V4L2DeviceBuffer* device_buffer) {
+    const uint32_t i = device_buffer->index;
+    const uint32_t length = v4l2_buf.GetLength();
+    if (i >= m_allocations.size() || m_allocations[i].size < length) {
+      const size_t page_size = sysconf(_SC_PAGESIZE);
+      const size_t size = (length + page_size - 1) / page_size * page_size;
+      Allocation allocation = {aligned_alloc(page_size, size), length};
+      CHECK(allocation.data);
+
+      if (i < m_allocations.size()) {
+        free(m_allocations[i].data);
+        m_allocations[i] = allocation;
+      } else {
+        m_allocations.push_back(allocation);
+      }
+    }
+
+    device_buffer->len = m_allocations[i].size;
+    device_buffer->data = m_allocations[i].data;
+    return 0;
+  }
+
+  void Prefault(const V4L2DeviceBuffer& device_buffer) {
+    rt_prefault(device_buffer.data, device_buffer.len, true);
+  }
+
+  template <typename Buffer>
+  void Prepare(V4L2DeviceBuffer* device_buffer,
+               const V4L2DeviceBuffer&,
+               Buffer& v4l2_buf) {
+    v4l2_buf.SetUserptr(device_buffer->data);
+    v4l2_buf.SetLength(device_buffer->len);
+  }
+
+  void Release(V4L2DeviceBuffer* device_buffer) {
+    device_buffer->data = nullptr;
+  }
+
+ private:
+  struct Allocation {
+    void* data;
+    uint32_t size;
+  };
+
+  std::vector<Allocation> m_allocations;
+};
+
+// Dmabufs owned by another device, passed in the `fd` of every queued
+// buffer, e.g. capture frames fed to a mem2mem device without a copy.
+// Dequeued buffers have no CPU mapping.
+template <typename Direction>
+class ImportMemory {
+ public:
+  static constexpr v4l2_memory kMemory = V4L2_MEMORY_DMABUF;
+  static constexpr const char* kName = "import";
+
+  template <typename Buffer>
+  int Allocate(int, Buffer& v4l2_buf, V4L2DeviceBuffer* device_buffer) {
+    device_buffer->len = v4l2_buf.GetLength();
+    device_buffer->data = nullptr;
+    return 0;
+  }
+
+  void Prefault(const V4L2DeviceBuffer&) {}
+
+  template <typename Buffer>
+  void Prepare(V4L2DeviceBuffer*,
+               const V4L2DeviceBuffer& queued,
+               Buffer& v4l2_buf) {
+    CHECK(queued.fd >= 0);
+    v4l2_buf.SetFd(queued.fd);
+    v4l2_buf.SetLength(queued.len);
+  }
+
+  void Release(V4L2DeviceBuffer*) {}
+};
+
+template <typename Direction,
+          template <typename> class MemoryPolicy,
+          typename PlanePolicy = SinglePlane>
+class V4L2StreamDevice final : public V4L2Device {
+ public:
+  using Memory = MemoryPolicy<Direction>;
+  using Buffer = typename PlanePolicy::Buffer;
+
+  static constexpr v4l2_buf_type kType = PlanePolicy::BufType(Direction::kType);
+
+  V4L2StreamDevice(int fd, int width, int height)
+      : m_fd(fd), m_width(width), m_height(height) {
+    Log(LogLevel::kInfo) << "V4L2StreamDevice " << Direction::kName << " "
+                         << Memory::kName;
+  }
+  ~V4L2StreamDevice() override { Release(); }
+
+  void Initialize(int buffer_count) override {
+    int ret;
+
+    m_buffer_count = buffer_count;
+
+    v4l2_requestbuffers reqbuf = {};
+    reqbuf.type = kType;
+    reqbuf.memory = Memory::kMemory;
+    reqbuf.count = buffer_count;
+
+    {
+      ScopedStartupTimer timer(std::string(Direction::kName) + " REQBUFS");
+      ret = ioctl(m_fd, VIDIOC_REQBUFS, &reqbuf);
+    }
+    if (ret != 0) {
+      const int err = errno;
+      Log(LogLevel::kError) << "ioctl(VIDIOC_REQBUFS) failed";
+      CHECK(SetLost(err));
+      return;
+    }
+
+    m_device_buffers.clear();
+    for (uint32_t i = 0; i < reqbuf.count; i++) {
+      ScopedStartupTimer timer(std::string(Direction::kName) + " QUERYBUF/" +
+                               Memory::kName);
+
+      Buffer v4l2_buf(kType, Memory::kMemory);
+      v4l2_buf.Get()->index = i;
+      if (ioctl(m_fd, VIDIOC_QUERYBUF, v4l2_buf.Get()) < 0) {
+        const int err = errno;
+        Log(LogLevel::kError) << "ioctl(VIDIOC_QUERYBUF) failed";
+        CHECK(SetLost(err));
+        return;
+      }
+
+      V4L2DeviceBuffer device_buffer = {};
+      device_buffer.index = i;
+      const int err = m_memory.Allocate(m_fd, v4l2_buf, &device_buffer);
+      if (err) {
+        CHECK(SetLost(err));
+        return;
+      }
+      m_device_buffers.push_back(device_buffer);
+    }
+
+    Log(LogLevel::kInfo) << "Required buffers " << buffer_count
+                         << ", created buffers " << reqbuf.count;
+  }
+
+  void Start() override {
+    int ret;
+
+    if constexpr (Direction::kPrequeue) {
+      for (uint32_t i = 0; i < m_device_buffers.size(); i++) {
+        Queue(m_device_buffers[i]);
+      }
+    }
+
+    v4l2_buf_type type = kType;
+    {
+      ScopedStartupTimer timer(std::string(Direction::kName) + " STREAMON");
+      ret = ioctl(m_fd, VIDIOC_STREAMON, &type);
+    }
+    if (ret < 0) {
+      const int err = errno;
+      Log(LogLevel::kError) << "ioctl(VIDIOC_STREAMON) failed";
+      CHECK(SetLost(err));
+      return;
+    }
+
+    Log(LogLevel::kInfo) << "Started";
+  }
+
+  void Prefault() override {
+    if (m_lost) {
+      return;
+    }
+
+    m_prefault = true;
+    ScopedStartupTimer timer(std::string(Direction::kName) + " prefault");
+    for (const V4L2DeviceBuffer& device_buffer : m_device_buffers) {
+      m_memory.Prefault(device_buffer);
+    }
+  }
+
+  void Queue(V4L2DeviceBuffer device_buffer) override {
+    if (m_lost) {
+      return;
+    }
+
+    ScopedTrace trace(Direction::kQueueTrace);
+    Buffer v4l2_buf(kType, Memory::kMemory);
+    v4l2_buf.Get()->index = device_buffer.index;
+    m_memory.Prepare(&m_device_buffers[device_buffer.index], device_buffer,
+                     v4l2_buf);
+    if constexpr (Direction::kIsOutput) {
+      v4l2_buf.SetBytesUsed(device_buffer.len);
+      v4l2_set_buffer_timestamp(v4l2_buf.Get(), device_buffer.timestamp_us);
+    }
+
+    if (ioctl(m_fd, VIDIOC_QBUF, v4l2_buf.Get()) < 0) {
+      const int err = errno;
+      Log(LogLevel::kError) << "ioctl(VIDIOC_QBUF) failed";
+      CHECK(SetLost(err));
+    }
+  }
+
+  V4L2DeviceBuffer Dequeue() override {
+    int ret;
+
+    if (m_lost) {
+      return {};
+    }
+
+    ScopedTrace trace(Direction::kDequeueTrace);
+    Buffer v4l2_buf(kType, Memory::kMemory);
+
+    // Attempt to dequeue a buffer, retrying if interrupted by a signal or if
+    // temporarily no buffer is available (in some configurations).
+    while ((ret = ioctl(m_fd, VIDIOC_DQBUF, v4l2_buf.Get())) < 0 &&
+           ((errno == EINTR) || (errno == EAGAIN))) {
+      // Sleep until a buffer is ready rather than spinning on EAGAIN
+      if (errno == EAGAIN) {
+        v4l2_poll(m_fd, Direction::kPollEvents);
+      }
+    }
+    if (ret < 0) {
+      const int err = errno;
+      Log(LogLevel::kError) << "ioctl(VIDIOC_DQBUF) failed";
+      CHECK(SetLost(err));
+      return {};
+    }
+
+    // FIXME: The v4l2loopback driver return zero buffer length, so the
+    // length from QUERYBUF is kept
+    V4L2DeviceBuffer dequeued = m_device_buffers[v4l2_buf.Get()->index];
+    if constexpr (!Direction::kIsOutput) {
+      dequeued.sequence = v4l2_buf.Get()->sequence;
+      dequeued.bytesused = v4l2_buf.GetBytesUsed();
+      dequeued.timestamp_us = v4l2_get_buffer_timestamp(*v4l2_buf.Get());
+      trace.SetArg(dequeued.sequence);
+    }
+    return dequeued;
+  }
+
+  int GetFd() const override { return m_fd; }
+
+  // Lease and LeaseNewest without virtual calls: the leases queue their
+  // buffers back through this class, so Dequeue, Queue and the memory
+  // policy inline into a loop that holds the device as its own type
+  BasicBufferLease<V4L2StreamDevice> Lease() {
+    return MakeLease(this, Dequeue());
+  }
+  BasicBufferLease<V4L2StreamDevice> LeaseNewest(uint64_t* discarded) {
+    return MakeLease(this, DequeueNewest(this, discarded));
+  }
+
+  // A buffer of a queue without kPrequeue that was not queued yet
+  V4L2DeviceBuffer GetBuffer(uint32_t index) const {
+    return m_device_buffers[index];
+  }
+  uint32_t GetBufferCount() const { return m_device_buffers.size(); }
+
+  void Release() override {
+    InvalidateLeases();
+    for (V4L2DeviceBuffer& device_buffer : m_device_buffers) {
+      m_memory.Release(&device_buffer);
+    }
+    m_device_buffers.clear();
+  }
+
+  void Reopen(int fd) override {
+    Release();
+
+    m_fd = fd;
+    m_lost = false;
+
+    Initialize(m_buffer_count);
+    if (m_prefault) {
+      Prefault();
+    }
+    Start();
+  }
+
+ private:
+  int m_fd;
+  int m_width;
+  int m_height;
+
+  int m_buffer_count = 0;
+  // Prefault again after a Reopen
+  bool m_prefault = false;
+
+  std::vector<V4L2DeviceBuffer> m_device_buffers;
+
+  Memory m_memory;
+};
+
+using CaptureDeviceMmap = V4L2StreamDevice<CaptureDirection, MmapMemory>;
+using CaptureDeviceExpbuf = V4L2StreamDevice<CaptureDirection, ExpbufMemory>;
+using CaptureDeviceDmabuf = V4L2StreamDevice<CaptureDirection, DmabufMemory>;
+using CaptureDeviceUserptr = V4L2StreamDevice<CaptureDirection, UserptrMemory>;
+
+using OutputDeviceMmap = V4L2StreamDevice<OutputDirection, MmapMemory>;
+using OutputDeviceExpbuf = V4L2StreamDevice<OutputDirection, ExpbufMemory>;
+using OutputDeviceDmabuf = V4L2StreamDevice<OutputDirection, DmabufMemory>;
+using OutputDeviceUserptr = V4L2StreamDevice<OutputDirection, UserptrMemory>;
+
+// Every capture and output device v4l2_create_*_device can return
+using CaptureDeviceRef = std::variant<CaptureDeviceMmap*,
+                                      CaptureDeviceExpbuf*,
+                                      CaptureDeviceDmabuf*,
+                                      CaptureDeviceUserptr*>;
+using OutputDeviceRef = std::variant<OutputDeviceMmap*,
+                                     OutputDeviceExpbuf*,
+                                     OutputDeviceDmabuf*,
+                                     OutputDeviceUserptr*>;
+
+enum class V4L2MemoryType { kMmap, kExpbuf, kDmabuf, kUserptr };
+
+// Parses "mmap", "expbuf", "dmabuf" or "userptr"
+bool v4l2_parse_memory_type(const std::string& name, V4L2MemoryType* type);
+
+// Single-planar stream devices for a memory type chosen at run time
+std::unique_ptr<V4L2Device> v4l2_create_capture_device(V4L2MemoryType type,
+                                                       int fd,
+                                                       int width,
+                                                       int height);
+std::unique_ptr<V4L2Device> v4l2_create_output_device(V4L2MemoryType type,
+                                                      int fd,
+                                                      int width,
+                                                      int height);
+
+// Returns a device created by v4l2_create_*_device as its own type, for
+// std::visit into a streaming loop, e.g.
+//
+//   std::visit([&](auto* capture) { ... capture->Lease() ... },
+//              v4l2_get_capture_device(device.get()));
+CaptureDeviceRef v4l2_get_capture_device(V4L2Device* device);
+OutputDeviceRef v4l2_get_output_device(V4L2Device* device);
+
+#endif /* __V4L2_STREAM_DEVICE_H__ */
@@ -28,15 +28,19 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include <cmath>
 #include <iostream>
+#include <numeric>
 
 #include <poll.h>
 #include <sys/ioctl.h>
 
 #include "check.h"
+#include "logger.h"
+#include "startup_timer.h"
 #include "v4l2_utils.h"
 
-static std::string fourcc_to_string(int fourcc) {
+std::string v4l2_fourcc_to_string(uint32_t fourcc) {
   char fourcc_chars[4];
   fourcc_chars[0] = fourcc & 0xff;
   fourcc_chars[1] = (fourcc >> 8) & 0xff;
@@ -55,15 +59,24 @@ bool v4l2_set_pix_format(int fd,
   format.type = v4l2_type;
   format.fmt.pix = *pix_format;
 
-  if (ioctl(fd, VIDIOC_S_FMT, &format) < 0) {
+  int ret;
+  {
+    ScopedStartupTimer timer(v4l2_type == V4L2_BUF_TYPE_VIDEO_OUTPUT
+                                 ? "output S_FMT"
+                                 : "capture S_FMT");
+    ret = ioctl(fd, VIDIOC_S_FMT, &format);
+  }
+  if (ret < 0) {
     std::cout << "ioctl(VIDIOC_S_FMT) failed\n";
-    CHECK(0);
+    return false;
   }
 
   if (pix_format->pixelformat != format.fmt.pix.pixelformat) {
     std::cout << "pixelformat not supported "
-              << fourcc_to_string(pix_format->pixelformat) << ", expected "
-              << fourcc_to_string(format.fmt.pix.pixelformat) << std::endl;
+              << v4l2_fourcc_to_string(pix_format->pixelformat)
+              << ", expected "
+              << v4l2_fourcc_to_string(format.fmt.pix.pixelformat)
+              << std::endl;
     return false;
   }
 
@@ -92,7 +105,7 @@ bool v4l2_set_pix_format(int fd,
   CHECK(format.fmt.pix.field != V4L2_FIELD_INTERLACED);
 
   std::cout << "Set device pix format: "
-            << fourcc_to_string(format.fmt.pix.pixelformat) << ", "
+            << v4l2_fourcc_to_string(format.fmt.pix.pixelformat) << ", "
             << format.fmt.pix.width << "x" << format.fmt.pix.height
             << ", bytesperline " << format.fmt.pix.bytesperline
             << ", sizeimage " << format.fmt.pix.sizeimage << std::endl;
@@ -111,6 +124,174 @@ std::string v4l2_get_device_name(int fd) {
   return std::string(reinterpret_cast<const char*>(cap.card));
 }
 
+std::vector<v4l2_fract> v4l2_get_frame_intervals(int fd,
+                                                 uint32_t pixelformat,
+                                                 uint32_t width,
+                                                 uint32_t height) {
+  std::vector<v4l2_fract> intervals;
+
+  v4l2_frmivalenum vfie = {};
+  vfie.pixel_format = pixelformat;
+  vfie.width = width;
+  vfie.height = height;
+
+  while (!ioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &vfie)) {
+    if (vfie.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
+      intervals.push_back(vfie.discrete);
+    } else {
+      intervals.push_back(vfie.stepwise.min);
+      intervals.push_back(vfie.stepwise.max);
+      break;
+    }
+    vfie.index += 1;
+  }
+
+  return intervals;
+}
+
+// Returns the interval of a stepwise or continuous range closest to 1 / fps:
+// clamped to the range and, unless continuous, snapped to its step
+static v4l2_fract fit_frame_interval(const v4l2_frmival_stepwise& range,
+                                     bool continuous,
+                                     uint32_t fps) {
+  // Intervals in units of 1 / denominator, where min and step are exact
+  const uint64_t denominator =
+      uint64_t(range.min.denominator) * range.step.denominator;
+  const uint64_t min = uint64_t(range.min.numerator) * range.step.denominator;
+  const uint64_t step = uint64_t(range.step.numerator) * range.min.denominator;
+  const double target = double(denominator) / fps;
+  if (!range.max.denominator || target <= min) {
+    return range.min;
+  }
+  if (target >= double(range.max.numerator) * denominator /
+                    range.max.denominator) {
+    return range.max;
+  }
+  if (continuous || !step) {
+    return {1, fps};
+  }
+
+  const uint64_t steps = uint64_t(std::llround((target - min) / step));
+  const uint64_t numerator = min + steps * step;
+  if (double(numerator) * range.max.denominator >
+      double(range.max.numerator) * denominator) {
+    return range.max;
+  }
+  const uint64_t divisor = std::gcd(numerator, denominator);
+  return {uint32_t(numerator / divisor), uint32_t(denominator / divisor)};
+}
+
+bool v4l2_set_frame_rate(int fd, uint32_t fps, v4l2_fract* timeperframe) {
+  CHECK(fps > 0);
+
+  v4l2_format format = {};
+  format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if (ioctl(fd, VIDIOC_G_FMT, &format) < 0) {
+    std::cout << "ioctl(VIDIOC_G_FMT) failed\n";
+    return false;
+  }
+
+  v4l2_frmivalenum vfie = {};
+  vfie.pixel_format = format.fmt.pix.pixelformat;
+  vfie.width = format.fmt.pix.width;
+  vfie.height = format.fmt.pix.height;
+  const bool enumerated = !ioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &vfie);
+
+  // Drivers that do not enumerate intervals get the requested rate as is,
+  // ranges the requested interval clamped and snapped to their step, and
+  // discrete lists the interval closest to the requested rate
+  v4l2_fract interval = {1, fps};
+  if (enumerated && vfie.type != V4L2_FRMIVAL_TYPE_DISCRETE) {
+    interval = fit_frame_interval(
+        vfie.stepwise, vfie.type == V4L2_FRMIVAL_TYPE_CONTINUOUS, fps);
+  } else if (enumerated) {
+    double best_diff = -1;
+    for (const v4l2_fract& candidate : v4l2_get_frame_intervals(
+             fd, format.fmt.pix.pixelformat, format.fmt.pix.width,
+             format.fmt.pix.height)) {
+      if (!candidate.numerator || !candidate.denominator) {
+        continue;
+      }
+
+      double diff = std::fabs(
+          double(candidate.denominator) / candidate.numerator - fps);
+      if (best_diff < 0 || diff < best_diff) {
+        best_diff = diff;
+        interval = candidate;
+      }
+    }
+  }
+
+  v4l2_streamparm parm = {};
+  parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  parm.parm.capture.timeperframe = interval;
+  if (ioctl(fd, VIDIOC_S_PARM, &parm) < 0) {
+    std::cout << "ioctl(VIDIOC_S_PARM) failed\n";
+    return false;
+  }
+
+  if (!(parm.parm.capture.capability & V4L2_CAP_TIMEPERFRAME)) {
+    std::cout << "Frame rate setting not supported\n";
+    return false;
+  }
+
+  *timeperframe = parm.parm.capture.timeperframe;
+  std::cout << "Set device frame rate: "
+            << float(timeperframe->denominator) / timeperframe->numerator
+            << ", requested " << fps << std::endl;
+  return true;
+}
+
+bool v4l2_get_frame_rate(int fd, v4l2_fract* timeperframe) {
+  v4l2_streamparm parm = {};
+  parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if (ioctl(fd, VIDIOC_G_PARM, &parm) < 0) {
+    std::cout << "ioctl(VIDIOC_G_PARM) failed\n";
+    return false;
+  }
+
+  if (!parm.parm.capture.timeperframe.numerator ||
+      !parm.parm.capture.timeperframe.denominator) {
+    return false;
+  }
+
+  *timeperframe = parm.parm.capture.timeperframe;
+  return true;
+}
+
+bool v4l2_set_crop(int fd, uint32_t v4l2_type, const v4l2_rect& rect) {
+  v4l2_selection selection = {};
+  selection.type = v4l2_type;
+  selection.target = V4L2_SEL_TGT_CROP;
+  selection.r = rect;
+  if (ioctl(fd, VIDIOC_S_SELECTION, &selection) < 0) {
+    std::cout << "ioctl(VIDIOC_S_SELECTION) failed\n";
+    return false;
+  }
+
+  if (selection.r.left != rect.left || selection.r.top != rect.top ||
+      selection.r.width != rect.width || selection.r.height != rect.height) {
+    std::cout << "Crop not supported " << rect.width << "x" << rect.height
+              << "+" << rect.left << "+" << rect.top << ", expected "
+              << selection.r.width << "x" << selection.r.height << "+"
+              << selection.r.left << "+" << selection.r.top << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool v4l2_reset_crop(int fd, uint32_t v4l2_type) {
+  v4l2_selection selection = {};
+  selection.type = v4l2_type;
+  selection.target = V4L2_SEL_TGT_CROP_DEFAULT;
+  if (ioctl(fd, VIDIOC_G_SELECTION, &selection) < 0) {
+    return false;
+  }
+
+  selection.target = V4L2_SEL_TGT_CROP;
+  return ioctl(fd, VIDIOC_S_SELECTION, &selection) == 0;
+}
+
 bool v4l2_poll(int fd, int events) {
   struct pollfd pfds = {0};
   pfds.fd = fd;
@@ -118,9 +299,28 @@ bool v4l2_poll(int fd, int events) {
 
   int ready = poll(&pfds, 1, -1);
   if (ready == -1) {
-    std::cout << "poll failed\n";
+    Log(LogLevel::kError) << "poll failed";
     return false;
   }
 
   return true;
 }
+
+uint64_t v4l2_get_buffer_timestamp(const v4l2_buffer& v4l2_buf) {
+  const uint32_t clock = v4l2_buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK;
+  if (clock != V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC &&
+      clock != V4L2_BUF_FLAG_TIMESTAMP_COPY) {
+    return 0;
+  }
+  return uint64_t(v4l2_buf.timestamp.tv_sec) * 1000000 +
+         v4l2_buf.timestamp.tv_usec;
+}
+
+void v4l2_set_buffer_timestamp(v4l2_buffer* v4l2_buf, uint64_t timestamp_us) {
+  if (timestamp_us == 0) {
+    return;
+  }
+  v4l2_buf->flags |= V4L2_BUF_FLAG_TIMESTAMP_COPY;
+  v4l2_buf->timestamp.tv_sec = timestamp_us / 1000000;
+  v4l2_buf->timestamp.tv_usec = timestamp_us % 1000000;
+}
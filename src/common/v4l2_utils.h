@@ -34,14 +34,49 @@
 #include <cstdint>
 
 #include <string>
+#include <vector>
 
 #include <linux/videodev2.h>
 
+std::string v4l2_fourcc_to_string(uint32_t fourcc);
+
 bool v4l2_set_pix_format(int fd,
                          uint32_t v4l2_type,
                          v4l2_pix_format* pix_format);
 
 std::string v4l2_get_device_name(int fd);
 
+// Returns the frame intervals supported for the given capture format. For
+// stepwise or continuous ranges only the minimum and maximum are returned.
+std::vector<v4l2_fract> v4l2_get_frame_intervals(int fd,
+                                                 uint32_t pixelformat,
+                                                 uint32_t width,
+                                                 uint32_t height);
+
+// Negotiates the supported capture frame interval closest to `fps` for the
+// current format: the nearest discrete interval, or 1 / fps clamped to a
+// stepwise or continuous range and snapped to its step. The interval
+// applied by the driver is returned in `timeperframe`.
+bool v4l2_set_frame_rate(int fd, uint32_t fps, v4l2_fract* timeperframe);
+
+bool v4l2_get_frame_rate(int fd, v4l2_fract* timeperframe);
+
+// Sets the crop rectangle of a queue with VIDIOC_S_SELECTION. Fails if the
+// driver does not support cropping or adjusted the rectangle.
+bool v4l2_set_crop(int fd, uint32_t v4l2_type, const v4l2_rect& rect);
+
+// Restores the default crop rectangle of a queue
+bool v4l2_reset_crop(int fd, uint32_t v4l2_type);
+
 bool v4l2_poll(int fd, int events);
+
+// Returns the CLOCK_MONOTONIC timestamp of a dequeued buffer in
+// microseconds, or zero if the driver uses another clock. Copied timestamps
+// are trusted to come from a producer on the monotonic clock.
+uint64_t v4l2_get_buffer_timestamp(const v4l2_buffer& v4l2_buf);
+
+// Marks an output buffer as carrying the capture timestamp `timestamp_us`,
+// so it is passed on to the consumer. Zero leaves the timestamp to the
+// driver.
+void v4l2_set_buffer_timestamp(v4l2_buffer* v4l2_buf, uint64_t timestamp_us);
 #endif /* __V4L2_UTILS_H__ */
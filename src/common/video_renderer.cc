@@ -0,0 +1,195 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <iostream>
+
+#include <libyuv.h>
+
+#include "null_video_renderer.h"
+#include "sdl2_video_renderer.h"
+#include "trace.h"
+#include "video_renderer.h"
+#include "yuv_utils.h"
+
+bool VideoRenderer::ParseBackend(const std::string& name, Backend* backend) {
+  if (name == "sdl") {
+    *backend = Backend::kSdl;
+  } else if (name == "offscreen") {
+    *backend = Backend::kOffscreen;
+  } else if (name == "null") {
+    *backend = Backend::kNull;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<VideoRenderer> VideoRenderer::Create(Backend backend,
+                                                     const char* name,
+                                                     const int window_width,
+                                                     const int window_height,
+                                                     const char* driver,
+                                                     bool vsync) {
+  switch (backend) {
+    case Backend::kSdl:
+      return std::make_unique<SDL2VideoRenderer>(name, window_width,
+                                                 window_height, driver, vsync);
+    case Backend::kOffscreen:
+      return std::make_unique<SDL2VideoRenderer>(
+          name, window_width, window_height, nullptr, false, true);
+    case Backend::kNull:
+      return std::make_unique<NullVideoRenderer>();
+  }
+  return nullptr;
+}
+
+void VideoRenderer::Report() const {
+  if (m_stats.frames == 0) {
+    return;
+  }
+  auto us = [&](uint64_t ns) { return ns / 1000 / m_stats.frames; };
+  std::cout << "Render " << GetDriverName() << ": " << m_stats.frames
+            << " frames, convert " << us(m_stats.convert_ns) << " us, update "
+            << us(m_stats.update_ns) << " us, copy " << us(m_stats.copy_ns)
+            << " us, present " << us(m_stats.present_ns) << " us per frame"
+            << std::endl;
+}
+
+uint32_t VideoRenderer::GetDownscaleFactor(uint32_t width, uint32_t height) {
+  int output_width = 0;
+  int output_height = 0;
+  if (!GetOutputSize(&output_width, &output_height)) {
+    return 1;
+  }
+
+  return yuv_box_factor(width, height, output_width, output_height);
+}
+
+void VideoRenderer::Reserve(uint32_t width, uint32_t height) {
+  // resize() zero-fills, which touches every page
+  GetI420Frame(width, height);
+}
+
+uint8_t* VideoRenderer::GetI420Frame(uint32_t width, uint32_t height) {
+  const size_t i420_size = width * height * 3 / 2;
+  if (m_i420_frame.size() < i420_size) {
+    m_i420_frame.resize(i420_size);
+  }
+
+  return m_i420_frame.data();
+}
+
+void VideoRenderer::RenderFrameYUY2(uint32_t width,
+                                    uint32_t height,
+                                    const uint8_t* data,
+                                    uint32_t stride) {
+  // When the window is much smaller than the frame, convert and box
+  // downscale in one pass so only about window-sized data is uploaded.
+  const uint32_t factor = GetDownscaleFactor(width, height);
+  if (factor > 1) {
+    const uint32_t dst_width = (width / factor) & ~1u;
+    const uint32_t dst_height = (height / factor) & ~1u;
+    uint8_t* i420_frame = GetI420Frame(dst_width, dst_height);
+    uint8_t* u_data = i420_frame + dst_width * dst_height;
+    uint8_t* v_data = u_data + dst_width * dst_height / 4;
+
+    const Clock::time_point start = Clock::now();
+    {
+      ScopedTrace trace("convert");
+      yuv_yuy2_to_i420_box(data, stride, width, height, factor, i420_frame,
+                           dst_width, u_data, dst_width / 2, v_data,
+                           dst_width / 2, &m_yuv_scratch);
+    }
+    m_stats.convert_ns += ElapsedNs(start, Clock::now());
+
+    RenderFrameI420(dst_width, dst_height, i420_frame, dst_width, u_data,
+                    dst_width / 2, v_data, dst_width / 2);
+    return;
+  }
+
+  uint8_t* i420_frame = GetI420Frame(width, height);
+  const Clock::time_point start = Clock::now();
+  {
+    ScopedTrace trace("convert");
+    libyuv::YUY2ToI420(data, stride, i420_frame, width,
+                       i420_frame + width * height, width / 2,
+                       i420_frame + width * height * 5 / 4, width / 2, width,
+                       height);
+  }
+  m_stats.convert_ns += ElapsedNs(start, Clock::now());
+
+  RenderFrameI420(width, height, i420_frame, width,
+                  i420_frame + width * height, width / 2,
+                  i420_frame + width * height * 5 / 4, width / 2);
+}
+
+void VideoRenderer::RenderFrameNV12(uint32_t width,
+                                    uint32_t height,
+                                    const uint8_t* y_data,
+                                    int y_stride,
+                                    const uint8_t* uv_data,
+                                    int uv_stride) {
+  const uint32_t factor = GetDownscaleFactor(width, height);
+  if (factor > 1) {
+    const uint32_t dst_width = (width / factor) & ~1u;
+    const uint32_t dst_height = (height / factor) & ~1u;
+    uint8_t* i420_frame = GetI420Frame(dst_width, dst_height);
+    uint8_t* u_data = i420_frame + dst_width * dst_height;
+    uint8_t* v_data = u_data + dst_width * dst_height / 4;
+
+    const Clock::time_point start = Clock::now();
+    {
+      ScopedTrace trace("convert");
+      yuv_nv12_to_i420_box(y_data, y_stride, uv_data, uv_stride, width, height,
+                           factor, i420_frame, dst_width, u_data, dst_width / 2,
+                           v_data, dst_width / 2, &m_yuv_scratch);
+    }
+    m_stats.convert_ns += ElapsedNs(start, Clock::now());
+
+    RenderFrameI420(dst_width, dst_height, i420_frame, dst_width, u_data,
+                    dst_width / 2, v_data, dst_width / 2);
+    return;
+  }
+
+  uint8_t* i420_frame = GetI420Frame(width, height);
+  const Clock::time_point start = Clock::now();
+  {
+    ScopedTrace trace("convert");
+    libyuv::NV12ToI420(y_data, y_stride, uv_data, uv_stride, i420_frame, width,
+                       i420_frame + width * height, width / 2,
+                       i420_frame + width * height * 5 / 4, width / 2, width,
+                       height);
+  }
+  m_stats.convert_ns += ElapsedNs(start, Clock::now());
+
+  RenderFrameI420(width, height, i420_frame, width,
+                  i420_frame + width * height, width / 2,
+                  i420_frame + width * height * 5 / 4, width / 2);
+}
@@ -0,0 +1,135 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __VIDEO_RENDERER_H__
+#define __VIDEO_RENDERER_H__
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "yuv_utils.h"
+
+// Time spent per render phase, accumulated over `frames` frames
+struct VideoRenderStats {
+  uint64_t frames = 0;
+  uint64_t convert_ns = 0;
+  uint64_t update_ns = 0;
+  uint64_t copy_ns = 0;
+  uint64_t present_ns = 0;
+};
+
+// Preview sink for captured frames. NV12 and YUY2 frames are converted to
+// I420, box downscaled to the output size when it is much smaller, and
+// handed to RenderFrameI420() of the backend:
+//
+// kSdl renders to an SDL window.
+// kOffscreen renders with the SDL software renderer into a memory surface,
+// paying the same conversion, texture update and scaling blit as a window
+// without needing a display.
+// kNull drops every frame, for measuring the pipeline without preview.
+class VideoRenderer {
+ public:
+  enum class Backend { kSdl, kOffscreen, kNull };
+
+  // Parses "sdl", "offscreen" or "null"
+  static bool ParseBackend(const std::string& name, Backend* backend);
+
+  // `driver` and `vsync` apply to the kSdl backend only
+  static std::unique_ptr<VideoRenderer> Create(Backend backend,
+                                               const char* name,
+                                               const int window_width = 640,
+                                               const int window_height = 360,
+                                               const char* driver = nullptr,
+                                               bool vsync = false);
+
+  virtual ~VideoRenderer() = default;
+
+  // Name of the render driver in use
+  virtual std::string GetDriverName() const = 0;
+
+  const VideoRenderStats& GetStats() const { return m_stats; }
+  void ResetStats() { m_stats = {}; }
+
+  // Prints the average time per frame of each render phase
+  void Report() const;
+
+  virtual void RenderFrameI420(uint32_t width,
+                               uint32_t height,
+                               const uint8_t* y_data,
+                               uint32_t y_pitch,
+                               const uint8_t* u_data,
+                               uint32_t u_pitch,
+                               const uint8_t* v_data,
+                               uint32_t v_pitch) = 0;
+
+  virtual void RenderFrameNV12(uint32_t width,
+                               uint32_t height,
+                               const uint8_t* y_data,
+                               int y_stride,
+                               const uint8_t* uv_data,
+                               int uv_stride);
+
+  virtual void RenderFrameYUY2(uint32_t width,
+                               uint32_t height,
+                               const uint8_t* data,
+                               uint32_t stride);
+
+  // Allocates the conversion scratch for frames up to width x height ahead
+  // of streaming, so the first frames do not page-fault.
+  void Reserve(uint32_t width, uint32_t height);
+
+ protected:
+  using Clock = std::chrono::steady_clock;
+
+  static uint64_t ElapsedNs(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+        .count();
+  }
+
+  // Size frames end up at on the output, false if unknown
+  virtual bool GetOutputSize(int* width, int* height) = 0;
+
+  VideoRenderStats m_stats;
+
+ private:
+  // Returns the box factor for downscaling a width x height frame to the
+  // current output size before upload.
+  uint32_t GetDownscaleFactor(uint32_t width, uint32_t height);
+
+  // Returns an I420 scratch frame of the given size, reused across frames.
+  uint8_t* GetI420Frame(uint32_t width, uint32_t height);
+
+  std::vector<uint8_t> m_i420_frame;
+  YuvScratch m_yuv_scratch;
+};
+#endif /* __VIDEO_RENDERER_H__ */
@@ -0,0 +1,471 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <vector>
+
+#include <libyuv.h>
+#include <linux/videodev2.h>
+
+#include "check.h"
+#include "yuv_utils.h"
+
+// Sums `factor` horizontally adjacent samples, `step` bytes apart, for each of
+// the `count` output columns of one source row into `acc`.
+static void box_accumulate_row(const uint8_t* row,
+                               uint32_t step,
+                               uint32_t factor,
+                               uint32_t count,
+                               uint32_t* acc) {
+  for (uint32_t x = 0; x < count; x++) {
+    const uint8_t* p = row + x * factor * step;
+    uint32_t sum = 0;
+    for (uint32_t k = 0; k < factor; k++) {
+      sum += p[k * step];
+    }
+    acc[x] += sum;
+  }
+}
+
+// Stores the averages of `count` sums of `n` samples, `step` bytes apart.
+static void box_store_row(const uint32_t* acc,
+                          uint32_t count,
+                          uint32_t n,
+                          uint8_t* dst,
+                          uint32_t step = 1) {
+  for (uint32_t x = 0; x < count; x++) {
+    dst[x * step] = static_cast<uint8_t>((acc[x] + n / 2) / n);
+  }
+}
+
+// Fused YUY2 to planar 4:2:0 box downscale. Chroma samples are written
+// `uv_step` bytes apart: 1 for I420, 2 for the interleaved plane of NV12.
+static void yuy2_to_planar_box(const uint8_t* src,
+                               uint32_t src_stride,
+                               uint32_t width,
+                               uint32_t height,
+                               uint32_t factor,
+                               uint8_t* y_data,
+                               uint32_t y_stride,
+                               uint8_t* u_data,
+                               uint32_t u_stride,
+                               uint8_t* v_data,
+                               uint32_t v_stride,
+                               uint32_t uv_step,
+                               YuvScratch* scratch) {
+  CHECK(factor >= 1);
+
+  const uint32_t dst_width = (width / factor) & ~1u;
+  const uint32_t dst_height = (height / factor) & ~1u;
+  const uint32_t uv_width = dst_width / 2;
+
+  std::vector<uint32_t>& y_acc = scratch->y_acc;
+  std::vector<uint32_t>& u_acc = scratch->u_acc;
+  std::vector<uint32_t>& v_acc = scratch->v_acc;
+  y_acc.resize(dst_width);
+  u_acc.resize(uv_width);
+  v_acc.resize(uv_width);
+
+  // Luma samples are 2 bytes apart; each chroma sample covers a pixel pair,
+  // so U and V are 4 bytes apart and a 2x2 chroma block spans 2*factor rows
+  // of `factor` pairs.
+  for (uint32_t uv_y = 0; uv_y < dst_height / 2; uv_y++) {
+    std::fill(u_acc.begin(), u_acc.end(), 0);
+    std::fill(v_acc.begin(), v_acc.end(), 0);
+
+    for (uint32_t half = 0; half < 2; half++) {
+      const uint32_t y = uv_y * 2 + half;
+      std::fill(y_acc.begin(), y_acc.end(), 0);
+
+      for (uint32_t k = 0; k < factor; k++) {
+        const uint8_t* row = src + (y * factor + k) * src_stride;
+        box_accumulate_row(row, 2, factor, dst_width, y_acc.data());
+        box_accumulate_row(row + 1, 4, factor, uv_width, u_acc.data());
+        box_accumulate_row(row + 3, 4, factor, uv_width, v_acc.data());
+      }
+
+      box_store_row(y_acc.data(), dst_width, factor * factor,
+                    y_data + y * y_stride);
+    }
+
+    box_store_row(u_acc.data(), uv_width, 2 * factor * factor,
+                  u_data + uv_y * u_stride, uv_step);
+    box_store_row(v_acc.data(), uv_width, 2 * factor * factor,
+                  v_data + uv_y * v_stride, uv_step);
+  }
+}
+
+using BilinearTap = YuvScaleTaps::Tap;
+
+// Taps for `dst_count` samples spread over `src_count` source samples,
+// with sample centers aligned and edges clamped.
+static std::vector<BilinearTap> bilinear_taps(uint32_t src_count,
+                                              uint32_t dst_count) {
+  std::vector<BilinearTap> taps(dst_count);
+  const double scale = double(src_count) / dst_count;
+  for (uint32_t i = 0; i < dst_count; i++) {
+    const double pos = std::clamp((i + 0.5) * scale - 0.5, 0.0,
+                                  double(src_count - 1));
+    const uint32_t i0 = static_cast<uint32_t>(pos);
+    taps[i].i0 = i0;
+    taps[i].i1 = std::min(i0 + 1, src_count - 1);
+    taps[i].frac = static_cast<uint32_t>((pos - i0) * 256 + 0.5);
+  }
+  return taps;
+}
+
+// Interpolates one destination row of samples `src_step` bytes apart in the
+// source rows r0 and r1, vertical weight `fy`, into samples `dst_step`
+// bytes apart.
+static void bilinear_row(const uint8_t* r0,
+                         const uint8_t* r1,
+                         uint32_t fy,
+                         const std::vector<BilinearTap>& taps,
+                         uint32_t src_step,
+                         uint8_t* dst,
+                         uint32_t dst_step) {
+  for (uint32_t x = 0; x < taps.size(); x++) {
+    const BilinearTap& tap = taps[x];
+    const uint32_t a = tap.i0 * src_step;
+    const uint32_t b = tap.i1 * src_step;
+    const uint32_t top = r0[a] * (256 - tap.frac) + r0[b] * tap.frac;
+    const uint32_t bottom = r1[a] * (256 - tap.frac) + r1[b] * tap.frac;
+    dst[x * dst_step] =
+        static_cast<uint8_t>((top * (256 - fy) + bottom * fy + 32768) >> 16);
+  }
+}
+
+// Taps of the bilinear YUY2 conversion to `dst_format`, recomputed only when
+// the format or a size differs from the last frame. The YUY2 source has
+// chroma on every row; a YUY2 destination too, a 4:2:0 one on every other.
+static const YuvScaleTaps& yuy2_scale_taps(uint32_t dst_format,
+                                           uint32_t src_width,
+                                           uint32_t src_height,
+                                           uint32_t dst_width,
+                                           uint32_t dst_height,
+                                           YuvScaleTaps* taps) {
+  if (taps->format != dst_format || taps->src_width != src_width ||
+      taps->src_height != src_height || taps->dst_width != dst_width ||
+      taps->dst_height != dst_height) {
+    const uint32_t uv_height =
+        dst_format == V4L2_PIX_FMT_YUYV ? dst_height : dst_height / 2;
+    taps->format = dst_format;
+    taps->src_width = src_width;
+    taps->src_height = src_height;
+    taps->dst_width = dst_width;
+    taps->dst_height = dst_height;
+    taps->x = bilinear_taps(src_width, dst_width);
+    taps->y = bilinear_taps(src_height, dst_height);
+    taps->uv_x = bilinear_taps(src_width / 2, dst_width / 2);
+    taps->uv_y = bilinear_taps(src_height, uv_height);
+  }
+  return *taps;
+}
+
+// Fused YUY2 conversion and bilinear scaling to any size, see
+// yuy2_scale_taps(). Luma samples are written `y_step` bytes apart, chroma
+// samples `uv_step` bytes apart, which covers YUY2 as well as I420 and NV12.
+static void yuy2_scale_bilinear(const uint8_t* src,
+                                uint32_t src_stride,
+                                const YuvScaleTaps& taps,
+                                uint8_t* y_data,
+                                uint32_t y_stride,
+                                uint32_t y_step,
+                                uint8_t* u_data,
+                                uint8_t* v_data,
+                                uint32_t uv_stride,
+                                uint32_t uv_step) {
+  for (uint32_t y = 0; y < taps.y.size(); y++) {
+    const BilinearTap& tap = taps.y[y];
+    bilinear_row(src + tap.i0 * src_stride, src + tap.i1 * src_stride,
+                 tap.frac, taps.x, 2, y_data + y * y_stride, y_step);
+  }
+
+  for (uint32_t y = 0; y < taps.uv_y.size(); y++) {
+    const BilinearTap& tap = taps.uv_y[y];
+    const uint8_t* r0 = src + tap.i0 * src_stride;
+    const uint8_t* r1 = src + tap.i1 * src_stride;
+    bilinear_row(r0 + 1, r1 + 1, tap.frac, taps.uv_x, 4,
+                 u_data + y * uv_stride, uv_step);
+    bilinear_row(r0 + 3, r1 + 3, tap.frac, taps.uv_x, 4,
+                 v_data + y * uv_stride, uv_step);
+  }
+}
+
+// Bilinear scaling of one plane of samples `src_step` and `dst_step` bytes
+// apart, for the destination rows [row_begin, row_end) only.
+static void scale_plane_rows(const uint8_t* src,
+                             uint32_t src_stride,
+                             uint32_t src_step,
+                             const std::vector<BilinearTap>& x_taps,
+                             const std::vector<BilinearTap>& y_taps,
+                             uint8_t* dst,
+                             uint32_t dst_stride,
+                             uint32_t dst_step,
+                             uint32_t row_begin,
+                             uint32_t row_end) {
+  for (uint32_t y = row_begin; y < row_end; y++) {
+    const BilinearTap& tap = y_taps[y];
+    bilinear_row(src + tap.i0 * src_stride, src + tap.i1 * src_stride,
+                 tap.frac, x_taps, src_step, dst + y * dst_stride, dst_step);
+  }
+}
+
+uint32_t yuv_box_factor(uint32_t src_width,
+                        uint32_t src_height,
+                        uint32_t dst_width,
+                        uint32_t dst_height) {
+  if (!dst_width || !dst_height) {
+    return 1;
+  }
+
+  uint32_t factor = std::min(src_width / dst_width, src_height / dst_height);
+  return factor >= 2 ? factor : 1;
+}
+
+void yuv_yuy2_to_i420_box(const uint8_t* src,
+                          uint32_t src_stride,
+                          uint32_t width,
+                          uint32_t height,
+                          uint32_t factor,
+                          uint8_t* y_data,
+                          uint32_t y_stride,
+                          uint8_t* u_data,
+                          uint32_t u_stride,
+                          uint8_t* v_data,
+                          uint32_t v_stride,
+                          YuvScratch* scratch) {
+  yuy2_to_planar_box(src, src_stride, width, height, factor, y_data, y_stride,
+                     u_data, u_stride, v_data, v_stride, 1, scratch);
+}
+
+void yuv_nv12_to_i420_box(const uint8_t* src_y,
+                          uint32_t src_y_stride,
+                          const uint8_t* src_uv,
+                          uint32_t src_uv_stride,
+                          uint32_t width,
+                          uint32_t height,
+                          uint32_t factor,
+                          uint8_t* y_data,
+                          uint32_t y_stride,
+                          uint8_t* u_data,
+                          uint32_t u_stride,
+                          uint8_t* v_data,
+                          uint32_t v_stride,
+                          YuvScratch* scratch) {
+  CHECK(factor >= 1);
+
+  const uint32_t dst_width = (width / factor) & ~1u;
+  const uint32_t dst_height = (height / factor) & ~1u;
+  const uint32_t uv_width = dst_width / 2;
+
+  std::vector<uint32_t>& y_acc = scratch->y_acc;
+  std::vector<uint32_t>& u_acc = scratch->u_acc;
+  std::vector<uint32_t>& v_acc = scratch->v_acc;
+  y_acc.resize(dst_width);
+  u_acc.resize(uv_width);
+  v_acc.resize(uv_width);
+
+  for (uint32_t y = 0; y < dst_height; y++) {
+    std::fill(y_acc.begin(), y_acc.end(), 0);
+    for (uint32_t k = 0; k < factor; k++) {
+      const uint8_t* row = src_y + (y * factor + k) * src_y_stride;
+      box_accumulate_row(row, 1, factor, dst_width, y_acc.data());
+    }
+    box_store_row(y_acc.data(), dst_width, factor * factor,
+                  y_data + y * y_stride);
+  }
+
+  // The source chroma plane is already subsampled 2x2, so the same factor
+  // applies to it directly.
+  for (uint32_t y = 0; y < dst_height / 2; y++) {
+    std::fill(u_acc.begin(), u_acc.end(), 0);
+    std::fill(v_acc.begin(), v_acc.end(), 0);
+    for (uint32_t k = 0; k < factor; k++) {
+      const uint8_t* row = src_uv + (y * factor + k) * src_uv_stride;
+      box_accumulate_row(row, 2, factor, uv_width, u_acc.data());
+      box_accumulate_row(row + 1, 2, factor, uv_width, v_acc.data());
+    }
+    box_store_row(u_acc.data(), uv_width, factor * factor,
+                  u_data + y * u_stride);
+    box_store_row(v_acc.data(), uv_width, factor * factor,
+                  v_data + y * v_stride);
+  }
+}
+
+bool yuv_convert_yuy2(const uint8_t* src,
+                      uint32_t src_stride,
+                      uint32_t src_width,
+                      uint32_t src_height,
+                      uint32_t dst_format,
+                      uint8_t* dst,
+                      uint32_t dst_stride,
+                      uint32_t dst_width,
+                      uint32_t dst_height,
+                      YuvScratch* scratch) {
+  const bool same_size = src_width == dst_width && src_height == dst_height;
+  const uint32_t factor = src_width / dst_width;
+  const bool box = factor >= 2 && src_width == dst_width * factor &&
+                   src_height == dst_height * factor && dst_width % 2 == 0 &&
+                   dst_height % 2 == 0;
+
+  auto taps = [&]() -> const YuvScaleTaps& {
+    return yuy2_scale_taps(dst_format, src_width, src_height, dst_width,
+                           dst_height, &scratch->taps);
+  };
+
+  // Planes of the single-plane V4L2 layouts
+  uint8_t* chroma = dst + size_t(dst_stride) * dst_height;
+  const uint32_t uv_height = dst_height / 2;
+
+  switch (dst_format) {
+    case V4L2_PIX_FMT_YUYV:
+      if (same_size) {
+        libyuv::CopyPlane(src, src_stride, dst, dst_stride, src_width * 2,
+                          src_height);
+      } else {
+        yuy2_scale_bilinear(src, src_stride, taps(), dst, dst_stride, 2,
+                            dst + 1, dst + 3, dst_stride, 4);
+      }
+      return true;
+
+    case V4L2_PIX_FMT_NV12:
+      if (same_size) {
+        libyuv::YUY2ToNV12(src, src_stride, dst, dst_stride, chroma,
+                           dst_stride, src_width, src_height);
+      } else if (box) {
+        yuy2_to_planar_box(src, src_stride, src_width, src_height, factor, dst,
+                           dst_stride, chroma, dst_stride, chroma + 1,
+                           dst_stride, 2, scratch);
+      } else {
+        yuy2_scale_bilinear(src, src_stride, taps(), dst, dst_stride, 1,
+                            chroma, chroma + 1, dst_stride, 2);
+      }
+      return true;
+
+    case V4L2_PIX_FMT_YUV420: {
+      const uint32_t uv_stride = dst_stride / 2;
+      uint8_t* v_plane = chroma + size_t(uv_stride) * uv_height;
+      if (same_size) {
+        libyuv::YUY2ToI420(src, src_stride, dst, dst_stride, chroma,
+                           uv_stride, v_plane, uv_stride, src_width,
+                           src_height);
+      } else if (box) {
+        yuy2_to_planar_box(src, src_stride, src_width, src_height, factor, dst,
+                           dst_stride, chroma, uv_stride, v_plane, uv_stride,
+                           1, scratch);
+      } else {
+        yuy2_scale_bilinear(src, src_stride, taps(), dst, dst_stride, 1,
+                            chroma, v_plane, uv_stride, 1);
+      }
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
+
+YuvScaleTaps yuv_scale_taps(uint32_t format,
+                            uint32_t src_width,
+                            uint32_t src_height,
+                            uint32_t dst_width,
+                            uint32_t dst_height) {
+  YuvScaleTaps taps;
+  taps.format = format;
+  taps.src_width = src_width;
+  taps.src_height = src_height;
+  taps.dst_width = dst_width;
+  taps.dst_height = dst_height;
+
+  // YUY2 chroma has every row, 4:2:0 chroma every other one
+  const uint32_t uv_divisor = format == V4L2_PIX_FMT_YUYV ? 1 : 2;
+  taps.x = bilinear_taps(src_width, dst_width);
+  taps.y = bilinear_taps(src_height, dst_height);
+  taps.uv_x = bilinear_taps(src_width / 2, dst_width / 2);
+  taps.uv_y = bilinear_taps(src_height / uv_divisor, dst_height / uv_divisor);
+  return taps;
+}
+
+bool yuv_scale_rows(const YuvScaleTaps& taps,
+                    const uint8_t* src,
+                    uint32_t src_stride,
+                    uint8_t* dst,
+                    uint32_t dst_stride,
+                    uint32_t row_begin,
+                    uint32_t row_end) {
+  CHECK(row_begin % 2 == 0 && row_end % 2 == 0);
+
+  switch (taps.format) {
+    case V4L2_PIX_FMT_YUYV:
+      scale_plane_rows(src, src_stride, 2, taps.x, taps.y, dst, dst_stride,
+                       2, row_begin, row_end);
+      scale_plane_rows(src + 1, src_stride, 4, taps.uv_x, taps.uv_y, dst + 1,
+                       dst_stride, 4, row_begin, row_end);
+      scale_plane_rows(src + 3, src_stride, 4, taps.uv_x, taps.uv_y, dst + 3,
+                       dst_stride, 4, row_begin, row_end);
+      return true;
+
+    case V4L2_PIX_FMT_NV12: {
+      const uint8_t* src_uv = src + size_t(src_stride) * taps.src_height;
+      uint8_t* dst_uv = dst + size_t(dst_stride) * taps.dst_height;
+      scale_plane_rows(src, src_stride, 1, taps.x, taps.y, dst, dst_stride,
+                       1, row_begin, row_end);
+      for (uint32_t offset = 0; offset < 2; offset++) {
+        scale_plane_rows(src_uv + offset, src_stride, 2, taps.uv_x,
+                         taps.uv_y, dst_uv + offset, dst_stride, 2,
+                         row_begin / 2, row_end / 2);
+      }
+      return true;
+    }
+
+    case V4L2_PIX_FMT_YUV420: {
+      const uint32_t src_uv_stride = src_stride / 2;
+      const uint32_t dst_uv_stride = dst_stride / 2;
+      const size_t src_uv_size =
+          size_t(src_uv_stride) * (taps.src_height / 2);
+      const size_t dst_uv_size =
+          size_t(dst_uv_stride) * (taps.dst_height / 2);
+      const uint8_t* src_u = src + size_t(src_stride) * taps.src_height;
+      uint8_t* dst_u = dst + size_t(dst_stride) * taps.dst_height;
+      scale_plane_rows(src, src_stride, 1, taps.x, taps.y, dst, dst_stride,
+                       1, row_begin, row_end);
+      for (uint32_t plane = 0; plane < 2; plane++) {
+        scale_plane_rows(src_u + plane * src_uv_size, src_uv_stride, 1,
+                         taps.uv_x, taps.uv_y, dst_u + plane * dst_uv_size,
+                         dst_uv_stride, 1, row_begin / 2, row_end / 2);
+      }
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
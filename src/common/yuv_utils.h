@@ -0,0 +1,149 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __YUV_UTILS_H__
+#define __YUV_UTILS_H__
+
+#include <cstdint>
+#include <vector>
+
+// Returns the integer box factor that brings a src_width x src_height frame
+// down to roughly dst_width x dst_height, or 1 when the destination is not at
+// least twice smaller in both dimensions.
+uint32_t yuv_box_factor(uint32_t src_width,
+                        uint32_t src_height,
+                        uint32_t dst_width,
+                        uint32_t dst_height);
+
+// Source samples and weights of a bilinear scale between two frame sizes,
+// for every destination column and row of the luma and chroma planes
+struct YuvScaleTaps {
+  // Two neighbouring source samples and the weight of the second in 1/256
+  struct Tap {
+    uint32_t i0;
+    uint32_t i1;
+    uint32_t frac;
+  };
+
+  uint32_t format = 0;
+  uint32_t src_width = 0;
+  uint32_t src_height = 0;
+  uint32_t dst_width = 0;
+  uint32_t dst_height = 0;
+
+  std::vector<Tap> x;
+  std::vector<Tap> y;
+  std::vector<Tap> uv_x;
+  std::vector<Tap> uv_y;
+};
+
+// Working memory of the conversions below, kept by the caller across frames
+// so they do not allocate per frame. Only the first frame, or one of a new
+// size, allocates. Not shared between threads.
+struct YuvScratch {
+  // Row accumulators of the box downscales
+  std::vector<uint32_t> y_acc;
+  std::vector<uint32_t> u_acc;
+  std::vector<uint32_t> v_acc;
+
+  // Taps of the bilinear path of yuv_convert_yuy2, for the destination
+  // format and sizes of the last frame
+  YuvScaleTaps taps;
+};
+
+// Fused YUY2 to I420 conversion and box downscale by an integer factor. The
+// destination is (width / factor) x (height / factor), rounded down to even.
+void yuv_yuy2_to_i420_box(const uint8_t* src,
+                          uint32_t src_stride,
+                          uint32_t width,
+                          uint32_t height,
+                          uint32_t factor,
+                          uint8_t* y_data,
+                          uint32_t y_stride,
+                          uint8_t* u_data,
+                          uint32_t u_stride,
+                          uint8_t* v_data,
+                          uint32_t v_stride,
+                          YuvScratch* scratch);
+
+// Fused NV12 to I420 conversion and box downscale by an integer factor.
+void yuv_nv12_to_i420_box(const uint8_t* src_y,
+                          uint32_t src_y_stride,
+                          const uint8_t* src_uv,
+                          uint32_t src_uv_stride,
+                          uint32_t width,
+                          uint32_t height,
+                          uint32_t factor,
+                          uint8_t* y_data,
+                          uint32_t y_stride,
+                          uint8_t* u_data,
+                          uint32_t u_stride,
+                          uint8_t* v_data,
+                          uint32_t v_stride,
+                          YuvScratch* scratch);
+
+// Converts a YUY2 frame to a single-plane V4L2 frame of `dst_format`
+// (V4L2_PIX_FMT_YUYV, NV12 or YUV420) of any even size, writing straight
+// into `dst` with luma rows `dst_stride` bytes apart. Conversion and scaling
+// run in one pass: exact integer downscales to NV12 or YUV420 use a box
+// filter, other sizes bilinear interpolation. Returns false for other
+// formats.
+bool yuv_convert_yuy2(const uint8_t* src,
+                      uint32_t src_stride,
+                      uint32_t src_width,
+                      uint32_t src_height,
+                      uint32_t dst_format,
+                      uint8_t* dst,
+                      uint32_t dst_stride,
+                      uint32_t dst_width,
+                      uint32_t dst_height,
+                      YuvScratch* scratch);
+
+// Computes the taps of yuv_scale_rows for `format` from src_width x
+// src_height to dst_width x dst_height, once per pair of sizes
+YuvScaleTaps yuv_scale_taps(uint32_t format,
+                            uint32_t src_width,
+                            uint32_t src_height,
+                            uint32_t dst_width,
+                            uint32_t dst_height);
+
+// Scales a single-plane V4L2 frame of `taps.format` (V4L2_PIX_FMT_YUYV, NV12
+// or YUV420) to another even size in the same format with bilinear
+// interpolation, writing only the destination rows [row_begin, row_end),
+// which must be even. Disjoint row ranges of one frame can be scaled
+// concurrently. Returns false for other formats.
+bool yuv_scale_rows(const YuvScaleTaps& taps,
+                    const uint8_t* src,
+                    uint32_t src_stride,
+                    uint8_t* dst,
+                    uint32_t dst_stride,
+                    uint32_t row_begin,
+                    uint32_t row_end);
+#endif /* __YUV_UTILS_H__ */
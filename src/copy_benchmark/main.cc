@@ -0,0 +1,181 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <cxxopts.hpp>
+
+#include "copy_utils.h"
+
+struct Config {
+  uint32_t frames;
+  uint32_t padding;
+  uint32_t working_set_kb;
+};
+
+void ParseCommandLine(int argc, char** argv, Config& config) {
+  try {
+    std::string program_name = argv[0];
+    cxxopts::Options options(program_name, "");
+
+    options.add_option("", {"h, help", "Print help"});
+
+    options.add_option("", {"frames", "Frames copied per measurement",
+                            cxxopts::value<uint32_t>()->default_value("200")});
+    options.add_option(
+        "", {"padding", "Destination bytesperline padding in bytes",
+             cxxopts::value<uint32_t>()->default_value("0")});
+    options.add_option(
+        "", {"working_set", "Working set in KiB re-read after every copy",
+             cxxopts::value<uint32_t>()->default_value("1024")});
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+      std::cout << options.help() << std::endl;
+      exit(0);
+    }
+
+    config.frames = result["frames"].as<uint32_t>();
+    config.padding = result["padding"].as<uint32_t>();
+    config.working_set_kb = result["working_set"].as<uint32_t>();
+  } catch (const cxxopts::exceptions::exception& e) {
+    std::cout << "error parsing options: " << e.what() << std::endl;
+    exit(-1);
+  }
+}
+
+// Keeps the working set reads from being optimized out
+volatile uint64_t g_sink = 0;
+
+// Sums a working set standing in for the rest of the pipeline, so the cost
+// of the copy evicting it from the cache shows up as re-read time
+uint64_t ReadWorkingSet(const std::vector<uint64_t>& working_set) {
+  uint64_t sum = 0;
+  for (uint64_t value : working_set) {
+    sum += value;
+  }
+  return sum;
+}
+
+void Benchmark(const Config& config, uint32_t width, uint32_t height) {
+  using Clock = std::chrono::steady_clock;
+
+  // YUYV frames, with the destination stride padded like a device buffer
+  const uint32_t row_bytes = width * 2;
+  const uint32_t dst_stride = row_bytes + config.padding;
+  const size_t src_size = size_t(row_bytes) * height;
+  const size_t dst_size = size_t(dst_stride) * height;
+
+  uint8_t* src = static_cast<uint8_t*>(aligned_alloc(64, src_size));
+  uint8_t* dst = static_cast<uint8_t*>(aligned_alloc(64, dst_size));
+  for (size_t i = 0; i < src_size; i++) {
+    src[i] = uint8_t(i * 7);
+  }
+  memset(dst, 0, dst_size);
+
+  std::vector<uint64_t> working_set(config.working_set_kb * 1024 /
+                                    sizeof(uint64_t), 1);
+
+  std::cout << width << "x" << height << " YUYV, stride " << dst_stride
+            << std::endl;
+
+  for (CopyKernel kernel : {CopyKernel::kMemcpy, CopyKernel::kSse2,
+                            CopyKernel::kAvx2, CopyKernel::kAvx512}) {
+    if (!copy_kernel_supported(kernel)) {
+      continue;
+    }
+
+    Clock::duration copy_time = {};
+    Clock::duration read_time = {};
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < config.frames; i++) {
+      sum += ReadWorkingSet(working_set);
+
+      Clock::time_point start = Clock::now();
+      copy_plane_with(kernel, dst, dst_stride, src, row_bytes, row_bytes,
+                      height);
+      Clock::time_point copied = Clock::now();
+      sum += ReadWorkingSet(working_set);
+      Clock::time_point read = Clock::now();
+
+      copy_time += copied - start;
+      read_time += read - copied;
+    }
+
+    for (uint32_t y = 0; y < height; y++) {
+      if (memcmp(dst + size_t(y) * dst_stride, src + size_t(y) * row_bytes,
+                 row_bytes) != 0) {
+        std::cout << "  " << copy_kernel_name(kernel) << " mismatch at row "
+                  << y << std::endl;
+        break;
+      }
+    }
+
+    const double copy_us =
+        std::chrono::duration<double, std::micro>(copy_time).count() /
+        config.frames;
+    const double read_us =
+        std::chrono::duration<double, std::micro>(read_time).count() /
+        config.frames;
+    std::cout << "  " << std::left << std::setw(8) << copy_kernel_name(kernel)
+              << std::right << std::fixed << std::setprecision(1)
+              << std::setw(9) << copy_us << " us/frame " << std::setw(6)
+              << src_size / copy_us / 1000 << " GB/s, working set re-read "
+              << std::setw(7) << read_us << " us" << std::endl;
+    g_sink = sum;
+  }
+
+  free(src);
+  free(dst);
+}
+
+int main(int argc, char* argv[]) {
+  Config config;
+  ParseCommandLine(argc, argv, config);
+
+  std::cout << "======" << std::endl;
+  std::cout << "frames: " << config.frames << std::endl;
+  std::cout << "padding: " << config.padding << std::endl;
+  std::cout << "working_set: " << config.working_set_kb << " KiB"
+            << std::endl;
+  std::cout << "best kernel: " << copy_kernel_name(copy_best_kernel())
+            << std::endl;
+
+  std::cout << "======" << std::endl;
+  Benchmark(config, 1920, 1080);
+  Benchmark(config, 3840, 2160);
+  return 0;
+}
@@ -29,16 +29,42 @@
 // POSSIBILITY OF SUCH DAMAGE.
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include <string>
 #include <thread>
 #include <vector>
 
+#include <linux/videodev2.h>
 #include <signal.h>
 
 #include <SDL2/SDL.h>
 
+#include <cxxopts.hpp>
+
+#include "pattern_generator.h"
+#include "sdl2_mosaic_renderer.h"
 #include "sdl2_video_renderer.h"
+#include "trace.h"
+
+struct Config {
+  bool benchmark;
+  std::string renderer;
+  uint32_t frames;
+  std::vector<std::string> drivers;
+  std::vector<std::string> formats;
+  std::vector<std::string> sizes;
+  std::string vsync;
+  uint32_t window_width;
+  uint32_t window_height;
+  uint32_t mosaic;
+  std::string trace;
+};
 
 bool g_quit = false;
 void sighandler(int) {
@@ -49,6 +75,82 @@ void sighandler(int) {
   }
 }
 
+std::vector<std::string> SplitList(const std::string& list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+void ParseCommandLine(int argc, char** argv, Config& config) {
+  try {
+    std::string program_name = argv[0];
+    cxxopts::Options options(program_name, "");
+
+    options.add_option("", {"h, help", "Print help"});
+
+    options.add_option(
+        "", {"benchmark", "Render pre-generated frames as fast as possible",
+             cxxopts::value<bool>()->default_value("false")->implicit_value(
+                 "true")});
+    options.add_option(
+        "", {"renderer", "Benchmark backend: sdl, offscreen or null",
+             cxxopts::value<std::string>()->default_value("sdl")});
+    options.add_option("", {"frames", "Frames rendered per benchmark run",
+                            cxxopts::value<uint32_t>()->default_value("300")});
+    options.add_option(
+        "", {"drivers", "SDL render drivers to compare",
+             cxxopts::value<std::string>()->default_value("software,opengl")});
+    options.add_option(
+        "", {"formats", "Frame formats: i420, nv12, yuy2",
+             cxxopts::value<std::string>()->default_value("i420,nv12,yuy2")});
+    options.add_option(
+        "", {"sizes", "Frame sizes",
+             cxxopts::value<std::string>()->default_value(
+                 "640x360,1280x720,1920x1080,3840x2160")});
+    options.add_option(
+        "", {"vsync", "Vsync: off, on or both",
+             cxxopts::value<std::string>()->default_value("off")});
+    options.add_option(
+        "", {"mosaic", "Composite N animated streams into one window",
+             cxxopts::value<uint32_t>()->default_value("0")});
+    options.add_option("", {"window_width", "Window width",
+                            cxxopts::value<uint32_t>()->default_value("640")});
+    options.add_option("", {"window_height", "Window height",
+                            cxxopts::value<uint32_t>()->default_value("360")});
+    options.add_option(
+        "", {"trace", "Write a Chrome trace here, toggled with SIGUSR1",
+             cxxopts::value<std::string>()->default_value("")});
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+      std::cout << options.help() << std::endl;
+      exit(0);
+    }
+
+    config.benchmark = result["benchmark"].as<bool>();
+    config.renderer = result["renderer"].as<std::string>();
+    config.frames = result["frames"].as<uint32_t>();
+    config.drivers = SplitList(result["drivers"].as<std::string>());
+    config.formats = SplitList(result["formats"].as<std::string>());
+    config.sizes = SplitList(result["sizes"].as<std::string>());
+    config.vsync = result["vsync"].as<std::string>();
+    config.window_width = result["window_width"].as<uint32_t>();
+    config.window_height = result["window_height"].as<uint32_t>();
+    config.mosaic = result["mosaic"].as<uint32_t>();
+    config.trace = result["trace"].as<std::string>();
+  } catch (const cxxopts::exceptions::exception& e) {
+    std::cout << "error parsing options: " << e.what() << std::endl;
+    exit(-1);
+  }
+}
+
 // Function to fill an I420 buffer with an animated color pattern based on a
 // frame number
 void FillI420BufferWithAnimatedPattern(
@@ -103,10 +205,228 @@ void FillI420BufferWithAnimatedPattern(
   }
 }
 
+// Renders pre-generated frames in a tight loop for every driver, vsync mode,
+// format and size, and prints the frame rate and per-phase timing
+int RunBenchmark(const Config& config) {
+  constexpr uint32_t kPatternFrames = 4;
+
+  VideoRenderer::Backend backend;
+  if (!VideoRenderer::ParseBackend(config.renderer, &backend)) {
+    std::cout << "Invalid renderer: " << config.renderer << std::endl;
+    return -1;
+  }
+
+  // Render drivers and vsync only apply to a window
+  std::vector<std::string> drivers = config.drivers;
+  std::vector<bool> vsync_modes;
+  if (backend != VideoRenderer::Backend::kSdl) {
+    drivers = {""};
+    vsync_modes = {false};
+  }
+  if (backend == VideoRenderer::Backend::kSdl &&
+      (config.vsync == "off" || config.vsync == "both")) {
+    vsync_modes.push_back(false);
+  }
+  if (backend == VideoRenderer::Backend::kSdl &&
+      (config.vsync == "on" || config.vsync == "both")) {
+    vsync_modes.push_back(true);
+  }
+  if (vsync_modes.empty()) {
+    std::cout << "Invalid vsync mode: " << config.vsync << std::endl;
+    return -1;
+  }
+
+  std::cout << std::left << std::setw(10) << "driver" << std::setw(6)
+            << "vsync" << std::setw(6) << "fmt" << std::setw(11) << "size"
+            << std::right << std::setw(8) << "fps" << std::setw(10)
+            << "convert" << std::setw(10) << "update" << std::setw(10)
+            << "copy" << std::setw(10) << "present"
+            << "  (us/frame)" << std::endl;
+
+  for (const std::string& driver : drivers) {
+    for (bool vsync : vsync_modes) {
+      std::unique_ptr<VideoRenderer> renderer = VideoRenderer::Create(
+          backend, "sdl2_renderer benchmark", config.window_width,
+          config.window_height, driver.empty() ? nullptr : driver.c_str(),
+          vsync);
+
+      for (const std::string& format : config.formats) {
+        uint32_t pixelformat;
+        if (format == "i420") {
+          pixelformat = V4L2_PIX_FMT_YUV420;
+        } else if (format == "nv12") {
+          pixelformat = V4L2_PIX_FMT_NV12;
+        } else if (format == "yuy2") {
+          pixelformat = V4L2_PIX_FMT_YUYV;
+        } else {
+          std::cout << "Invalid format: " << format << std::endl;
+          return -1;
+        }
+
+        for (const std::string& size : config.sizes) {
+          uint32_t width = 0;
+          uint32_t height = 0;
+          if (sscanf(size.c_str(), "%ux%u", &width, &height) != 2) {
+            std::cout << "Invalid size: " << size << std::endl;
+            return -1;
+          }
+
+          // Pre-generate a few frames so the loop measures rendering only
+          const uint32_t stride =
+              PatternGenerator::GetBytesPerLine(pixelformat, width);
+          const size_t frame_size =
+              PatternGenerator::GetFrameSize(pixelformat, stride, height);
+          PatternGenerator generator(pixelformat, width, height, stride);
+          std::vector<std::vector<uint8_t>> frames(kPatternFrames);
+          for (uint32_t i = 0; i < kPatternFrames; i++) {
+            frames[i].resize(frame_size);
+            generator.Fill(frames[i].data(), frames[i].size(), i, 0);
+          }
+
+          renderer->ResetStats();
+          auto start = std::chrono::steady_clock::now();
+          for (uint32_t i = 0; i < config.frames && !g_quit; i++) {
+            const uint8_t* y_data = frames[i % kPatternFrames].data();
+            const uint8_t* chroma = y_data + size_t(stride) * height;
+            if (pixelformat == V4L2_PIX_FMT_YUV420) {
+              renderer->RenderFrameI420(width, height, y_data, stride, chroma,
+                                        stride / 2,
+                                        chroma + stride / 2 * height / 2,
+                                        stride / 2);
+            } else if (pixelformat == V4L2_PIX_FMT_NV12) {
+              renderer->RenderFrameNV12(width, height, y_data, stride, chroma,
+                                        stride);
+            } else {
+              renderer->RenderFrameYUY2(width, height, y_data, stride);
+            }
+          }
+          const double seconds = std::chrono::duration<double>(
+                                     std::chrono::steady_clock::now() - start)
+                                     .count();
+
+          const VideoRenderStats& stats = renderer->GetStats();
+          if (stats.frames == 0) {
+            continue;
+          }
+          auto us = [&](uint64_t ns) { return ns / 1000 / stats.frames; };
+          std::cout << std::left << std::setw(10)
+                    << renderer->GetDriverName() << std::setw(6)
+                    << (vsync ? "on" : "off") << std::setw(6) << format
+                    << std::setw(11) << size << std::right << std::setw(8)
+                    << uint32_t(stats.frames / seconds) << std::setw(10)
+                    << us(stats.convert_ns) << std::setw(10)
+                    << us(stats.update_ns) << std::setw(10)
+                    << us(stats.copy_ns) << std::setw(10)
+                    << us(stats.present_ns) << std::endl;
+        }
+      }
+    }
+  }
+  Trace::Flush();
+  return 0;
+}
+
+// Feeds `count` pattern streams of mixed formats and sizes at about 30 fps
+// each into one mosaic window, and prints presents and tile updates per
+// second
+int RunMosaic(const Config& config) {
+  struct Stream {
+    uint32_t pixelformat;
+    uint32_t width;
+    uint32_t height;
+  };
+  const Stream kStreams[] = {
+      {V4L2_PIX_FMT_YUYV, 1280, 720},  {V4L2_PIX_FMT_NV12, 1920, 1080},
+      {V4L2_PIX_FMT_YUV420, 640, 360}, {V4L2_PIX_FMT_YUYV, 3840, 2160},
+      {V4L2_PIX_FMT_NV12, 640, 480},   {V4L2_PIX_FMT_YUV420, 1280, 720},
+  };
+  constexpr auto kFrameInterval = std::chrono::microseconds(33333);
+
+  SDL2MosaicRenderer mosaic("sdl2_renderer mosaic", config.mosaic, 1280, 720);
+
+  std::atomic<bool> stop = false;
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < config.mosaic; i++) {
+    threads.emplace_back([&, i]() {
+      Trace::SetThreadName("stream " + std::to_string(i));
+      const Stream& stream = kStreams[i % std::size(kStreams)];
+      const uint32_t stride =
+          PatternGenerator::GetBytesPerLine(stream.pixelformat, stream.width);
+      PatternGenerator generator(stream.pixelformat, stream.width,
+                                 stream.height, stride);
+      std::vector<uint8_t> frame(PatternGenerator::GetFrameSize(
+          stream.pixelformat, stride, stream.height));
+
+      auto next = std::chrono::steady_clock::now();
+      for (uint64_t n = 0; !stop; n++) {
+        generator.Fill(frame.data(), frame.size(), n, 0);
+
+        const uint8_t* y_data = frame.data();
+        const uint8_t* chroma = y_data + size_t(stride) * stream.height;
+        if (stream.pixelformat == V4L2_PIX_FMT_YUV420) {
+          mosaic.UpdateTileI420(i, stream.width, stream.height, y_data, stride,
+                                chroma, stride / 2,
+                                chroma + stride / 2 * stream.height / 2,
+                                stride / 2);
+        } else if (stream.pixelformat == V4L2_PIX_FMT_NV12) {
+          mosaic.UpdateTileNV12(i, stream.width, stream.height, y_data, stride,
+                                chroma, stride);
+        } else {
+          mosaic.UpdateTileYUY2(i, stream.width, stream.height, y_data,
+                                stride);
+        }
+
+        next += kFrameInterval;
+        std::this_thread::sleep_until(next);
+      }
+    });
+  }
+
+  auto report = std::chrono::steady_clock::now();
+  uint64_t presents = 0;
+  uint64_t updates = 0;
+  while (!g_quit) {
+    mosaic.Present();
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - report >= std::chrono::seconds(1)) {
+      std::cout << "Presents " << mosaic.GetPresentCount() - presents
+                << "/s, tile updates " << mosaic.GetTileUpdateCount() - updates
+                << "/s" << std::endl;
+      presents = mosaic.GetPresentCount();
+      updates = mosaic.GetTileUpdateCount();
+      report = now;
+    }
+  }
+
+  stop = true;
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  Trace::Flush();
+  return 0;
+}
+
 int main(int argc, char* argv[]) {
   constexpr uint32_t kVideoWidth = 1280;
   constexpr uint32_t kVideoHeight = 720;
 
+  Config config;
+  ParseCommandLine(argc, argv, config);
+
+  if (!config.trace.empty() && !Trace::Initialize(config.trace)) {
+    return -1;
+  }
+  Trace::SetThreadName("render");
+
+  signal(SIGINT, sighandler);
+  if (config.benchmark) {
+    return RunBenchmark(config);
+  }
+  if (config.mosaic) {
+    return RunMosaic(config);
+  }
+
   // Create renderer with default windows 640x360
   std::unique_ptr<SDL2VideoRenderer> renderer =
       std::make_unique<SDL2VideoRenderer>();
@@ -129,7 +449,6 @@ int main(int argc, char* argv[]) {
 
   // Main loop
   uint64_t frames = 0;
-  signal(SIGINT, sighandler);
   while (!g_quit) {
     // Fill the I420 buffer with an animated pattern
     FillI420BufferWithAnimatedPattern(kVideoWidth, kVideoHeight, y_data,
@@ -144,6 +463,8 @@ int main(int argc, char* argv[]) {
     std::this_thread::sleep_for(std::chrono::seconds(1));
   }
 
+  Trace::Flush();
+
   // Clean up
   renderer.reset();
   return 0;
@@ -0,0 +1,717 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cxxopts.hpp>
+
+struct Config {
+  std::string vivid_device;
+  std::string loopback_device;
+  bool load_modules;
+
+  std::string pipelines;
+  std::string sizes;
+  std::string modes;
+  uint32_t fps;
+  uint32_t duration;
+
+  std::string bin_dir;
+  std::string log_dir;
+  std::string output;
+  std::string baseline;
+  double tolerance;
+  uint32_t drop_slack;
+};
+
+void ParseCommandLine(int argc, char** argv, Config& config) {
+  try {
+    std::string program_name = argv[0];
+    cxxopts::Options options(program_name, "");
+
+    options.add_option("", {"h, help", "Print help"});
+
+    options.add_option(
+        "", {"vivid", "vivid capture device",
+             cxxopts::value<std::string>()->default_value("/dev/video40")});
+    options.add_option(
+        "", {"loopback", "v4l2loopback device",
+             cxxopts::value<std::string>()->default_value("/dev/video41")});
+    options.add_option(
+        "", {"load_modules",
+             "Reload vivid and v4l2loopback with the benchmark parameters "
+             "(default: false)",
+             cxxopts::value<bool>()->default_value("false")->implicit_value(
+                 "true")});
+    options.add_option(
+        "", {"pipelines", "Pipelines to run: player, clone, resize",
+             cxxopts::value<std::string>()->default_value(
+                 "player,clone,resize")});
+    options.add_option(
+        "", {"sizes", "Frame sizes to run",
+             cxxopts::value<std::string>()->default_value(
+                 "640x360,1280x720,1920x1080,3840x2160")});
+    options.add_option(
+        "", {"modes", "Buffer modes to run: mmap, dmabuf",
+             cxxopts::value<std::string>()->default_value("mmap,dmabuf")});
+    options.add_option("", {"fps", "Capture frame rate",
+                            cxxopts::value<uint32_t>()->default_value("30")});
+    options.add_option("", {"duration", "Seconds per scenario",
+                            cxxopts::value<uint32_t>()->default_value("10")});
+    options.add_option(
+        "", {"bin_dir", "Directory of the apps (default: next to this one)",
+             cxxopts::value<std::string>()->default_value("")});
+    options.add_option(
+        "", {"log_dir", "Directory for the output of the apps",
+             cxxopts::value<std::string>()->default_value("benchmark_logs")});
+    options.add_option(
+        "", {"o, output", "Write the results as JSON to this file",
+             cxxopts::value<std::string>()->default_value("")});
+    options.add_option(
+        "", {"b, baseline", "Compare against the results in this file",
+             cxxopts::value<std::string>()->default_value("")});
+    options.add_option(
+        "", {"tolerance", "Allowed regression in percent",
+             cxxopts::value<double>()->default_value("10")});
+    options.add_option(
+        "", {"drop_slack", "Allowed extra dropped frames",
+             cxxopts::value<uint32_t>()->default_value("2")});
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+      std::cout << options.help() << std::endl;
+      exit(0);
+    }
+
+    config.vivid_device = result["vivid"].as<std::string>();
+    config.loopback_device = result["loopback"].as<std::string>();
+    config.load_modules = result["load_modules"].as<bool>();
+    config.pipelines = result["pipelines"].as<std::string>();
+    config.sizes = result["sizes"].as<std::string>();
+    config.modes = result["modes"].as<std::string>();
+    config.fps = result["fps"].as<uint32_t>();
+    config.duration = result["duration"].as<uint32_t>();
+    config.bin_dir = result["bin_dir"].as<std::string>();
+    config.log_dir = result["log_dir"].as<std::string>();
+    config.output = result["output"].as<std::string>();
+    config.baseline = result["baseline"].as<std::string>();
+    config.tolerance = result["tolerance"].as<double>();
+    config.drop_slack = result["drop_slack"].as<uint32_t>();
+  } catch (const cxxopts::exceptions::exception& e) {
+    std::cout << "error parsing options: " << e.what() << std::endl;
+    exit(-1);
+  }
+}
+
+std::vector<std::string> SplitList(const std::string& list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+// Measurements of one scenario. Counters are -1 when the app did not
+// report them. A scenario whose devices are missing is `skipped` rather
+// than failed.
+struct Result {
+  std::string name;
+  std::string skipped;
+  std::string error;
+
+  uint64_t frames = 0;
+  double fps = 0;
+  int64_t drops = -1;
+  double player_cpu_us = 0;
+  double clone_cpu_us = 0;
+
+  int64_t latency_avg_us = -1;
+  int64_t latency_p50_us = -1;
+  int64_t latency_p95_us = -1;
+  int64_t latency_p99_us = -1;
+  int64_t latency_max_us = -1;
+};
+
+// An app started with its stdout and stderr in a log file, and its device
+// cache in `cache_dir` so no scenario sees the formats of another
+struct Process {
+  pid_t pid = -1;
+  std::string log_path;
+  rusage usage = {};
+  bool exited_early = false;
+};
+
+bool StartProcess(const std::string& binary,
+                  const std::vector<std::string>& args,
+                  const std::string& log_path,
+                  const std::string& cache_dir,
+                  Process* process) {
+  process->log_path = log_path;
+  process->pid = fork();
+  if (process->pid < 0) {
+    std::cout << "fork failed" << std::endl;
+    return false;
+  }
+
+  if (process->pid == 0) {
+    const int fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+      dup2(fd, STDOUT_FILENO);
+      dup2(fd, STDERR_FILENO);
+      close(fd);
+    }
+    setenv("XDG_CACHE_HOME", cache_dir.c_str(), 1);
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(binary.c_str()));
+    for (const std::string& arg : args) {
+      argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    execv(binary.c_str(), argv.data());
+    _exit(127);
+  }
+  return true;
+}
+
+// Stops the app with SIGINT, as on Ctrl-C, so it prints its reports.
+// Killed if it does not exit within a few seconds.
+void StopProcess(Process* process) {
+  if (process->pid < 0) {
+    return;
+  }
+
+  int status;
+  if (wait4(process->pid, &status, WNOHANG, &process->usage) ==
+      process->pid) {
+    process->exited_early = true;
+    process->pid = -1;
+    return;
+  }
+
+  kill(process->pid, SIGINT);
+  for (int i = 0; i < 50; i++) {
+    if (wait4(process->pid, &status, WNOHANG, &process->usage) ==
+        process->pid) {
+      process->pid = -1;
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  std::cout << "Killing " << process->log_path << std::endl;
+  kill(process->pid, SIGKILL);
+  wait4(process->pid, &status, 0, &process->usage);
+  process->pid = -1;
+}
+
+double CpuUs(const rusage& usage) {
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 +
+         usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+std::vector<std::string> ReadLines(const std::string& path) {
+  std::vector<std::string> lines;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+// Reads `Checksum capture (...): frames N, sequence gaps G`
+bool ParseChecksumReport(const std::vector<std::string>& lines,
+                         uint64_t* frames,
+                         uint64_t* gaps) {
+  for (const std::string& line : lines) {
+    if (line.rfind("Checksum capture", 0) != 0) {
+      continue;
+    }
+    const size_t pos = line.find("): ");
+    if (pos != std::string::npos &&
+        sscanf(line.c_str() + pos, "): frames %lu, sequence gaps %lu", frames,
+               gaps) == 2) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Reads the player's `Capture format: WxH` line
+bool ParseCaptureFormat(const std::vector<std::string>& lines,
+                        std::string* size) {
+  for (const std::string& line : lines) {
+    uint32_t width;
+    uint32_t height;
+    if (sscanf(line.c_str(), "Capture format: %ux%u", &width, &height) ==
+        2) {
+      *size = std::to_string(width) + "x" + std::to_string(height);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Reads the player's `Capture to display N frames, latency avg ...` line
+void ParseLatencyReport(const std::vector<std::string>& lines,
+                        Result* result) {
+  for (const std::string& line : lines) {
+    uint64_t frames;
+    if (sscanf(line.c_str(),
+               "Capture to display %lu frames, latency avg %ld us p50 %ld us "
+               "p95 %ld us p99 %ld us max %ld us",
+               &frames, &result->latency_avg_us, &result->latency_p50_us,
+               &result->latency_p95_us, &result->latency_p99_us,
+               &result->latency_max_us) == 6) {
+      return;
+    }
+  }
+}
+
+std::string SizeArg(const std::string& size, char part) {
+  const size_t x = size.find('x');
+  return part == 'w' ? size.substr(0, x) : size.substr(x + 1);
+}
+
+// Half of `size`, rounded down to even
+std::string HalfSize(const std::string& size) {
+  const uint32_t width = std::stoul(SizeArg(size, 'w')) / 2 & ~1u;
+  const uint32_t height = std::stoul(SizeArg(size, 'h')) / 2 & ~1u;
+  return std::to_string(width) + "x" + std::to_string(height);
+}
+
+// Streams vivid -> v4l2_clone_device -> v4l2loopback -> v4l2_player at
+// `size` for a moment, with the device cache in `cache_dir`, and returns the
+// size the player captured or an empty string
+std::string StreamLoopback(const Config& config,
+                           const std::string& size,
+                           const std::string& log_prefix,
+                           const std::string& cache_dir) {
+  const std::string width = SizeArg(size, 'w');
+  const std::string height = SizeArg(size, 'h');
+
+  Process clone_process;
+  if (!StartProcess(config.bin_dir + "/v4l2_clone_device",
+                    {"-i", config.vivid_device, "-o", config.loopback_device,
+                     "--width", width, "--height", height, "--not_show",
+                     "--log_level", "warning"},
+                    log_prefix + "_clone.log", cache_dir, &clone_process)) {
+    return "";
+  }
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+
+  Process player_process;
+  if (StartProcess(config.bin_dir + "/v4l2_player",
+                   {"-i", config.loopback_device, "--width", width,
+                    "--height", height, "--renderer", "null"},
+                   log_prefix + "_player.log", cache_dir, &player_process)) {
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    StopProcess(&player_process);
+  }
+  StopProcess(&clone_process);
+
+  std::string captured;
+  ParseCaptureFormat(ReadLines(player_process.log_path), &captured);
+  return captured;
+}
+
+// Runs vivid -> v4l2_player, or vivid -> v4l2_clone_device ->
+// v4l2loopback -> v4l2_player, for the configured duration. `resize` runs
+// the clone pipeline after streaming the loopback at half the size with the
+// same device cache, so the player must follow a producer that changed
+// resolution between two runs.
+Result RunScenario(const Config& config,
+                   const std::string& pipeline,
+                   const std::string& size,
+                   const std::string& mode) {
+  Result result;
+  result.name = pipeline + "_" + size + "_" + mode;
+
+  const bool resize = pipeline == "resize";
+  const bool clone = pipeline == "clone" || resize;
+  const bool dmabuf = mode == "dmabuf";
+  const std::string width = SizeArg(size, 'w');
+  const std::string height = SizeArg(size, 'h');
+
+  if (access(config.vivid_device.c_str(), R_OK | W_OK) != 0) {
+    result.skipped = "vivid not available";
+    return result;
+  }
+  if (clone && access(config.loopback_device.c_str(), R_OK | W_OK) != 0) {
+    result.skipped = "v4l2loopback not available";
+    return result;
+  }
+
+  // The clone sets the capture rate itself, the player leaves it as is
+  if (!clone && system(("v4l2-ctl -d " + config.vivid_device + " -p " +
+                        std::to_string(config.fps) + " >/dev/null")
+                           .c_str()) != 0) {
+    std::cout << "Could not set the vivid frame rate" << std::endl;
+  }
+
+  // A fresh device cache per scenario, as the loopback changes size
+  const std::string cache_dir = config.log_dir + "/" + result.name + "_cache";
+  std::error_code ec;
+  std::filesystem::remove_all(cache_dir, ec);
+
+  if (resize) {
+    const std::string first_size = HalfSize(size);
+    const std::string captured =
+        StreamLoopback(config, first_size,
+                       config.log_dir + "/" + result.name + "_first",
+                       cache_dir);
+    if (captured != first_size) {
+      result.error = "first run at " + first_size + " failed, see " +
+                     config.log_dir;
+      return result;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  }
+
+  // Checksums count the frames and sequence gaps on every hop
+  Process clone_process;
+  if (clone) {
+    const std::vector<std::string> args = {
+        "-i", config.vivid_device, "-o", config.loopback_device,
+        "--width", width, "--height", height,
+        "--fps", std::to_string(config.fps), "--not_show",
+        "--capture_memory", dmabuf ? "expbuf" : "mmap",
+        "--output_memory", dmabuf ? "dmabuf" : "mmap",
+        "--checksum", "/dev/null", "--log_level", "warning"};
+    if (!StartProcess(config.bin_dir + "/v4l2_clone_device", args,
+                      config.log_dir + "/" + result.name + "_clone.log",
+                      cache_dir, &clone_process)) {
+      result.error = "clone failed to start";
+      return result;
+    }
+    // The loopback device has no format until the producer streams
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+  }
+
+  const std::vector<std::string> player_args = {
+      "-i", clone ? config.loopback_device : config.vivid_device,
+      "--width", width, "--height", height,
+      "--renderer", "null", "--memory", dmabuf ? "expbuf" : "mmap",
+      "--checksum", "/dev/null"};
+  Process player_process;
+  const auto start = std::chrono::steady_clock::now();
+  if (!StartProcess(config.bin_dir + "/v4l2_player", player_args,
+                    config.log_dir + "/" + result.name + "_player.log",
+                    cache_dir, &player_process)) {
+    StopProcess(&clone_process);
+    result.error = "player failed to start";
+    return result;
+  }
+
+  std::this_thread::sleep_for(std::chrono::seconds(config.duration));
+
+  StopProcess(&player_process);
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  StopProcess(&clone_process);
+
+  if (player_process.exited_early || clone_process.exited_early) {
+    result.error = "app exited early, see " + config.log_dir;
+    return result;
+  }
+
+  const std::vector<std::string> player_lines =
+      ReadLines(player_process.log_path);
+  std::string negotiated;
+  if (!ParseCaptureFormat(player_lines, &negotiated) || negotiated != size) {
+    result.error = "player captured " +
+                   (negotiated.empty() ? "no format" : negotiated) +
+                   " instead of " + size;
+    return result;
+  }
+  uint64_t gaps = 0;
+  if (!ParseChecksumReport(player_lines, &result.frames, &gaps) ||
+      result.frames == 0) {
+    result.error = "no frames received";
+    return result;
+  }
+  result.fps = result.frames / seconds;
+  result.drops = gaps;
+  result.player_cpu_us = CpuUs(player_process.usage) / result.frames;
+  ParseLatencyReport(player_lines, &result);
+
+  if (clone) {
+    uint64_t clone_frames = 0;
+    uint64_t clone_gaps = 0;
+    if (ParseChecksumReport(ReadLines(clone_process.log_path), &clone_frames,
+                            &clone_gaps) &&
+        clone_frames) {
+      result.drops += clone_gaps;
+      result.clone_cpu_us = CpuUs(clone_process.usage) / clone_frames;
+    }
+  }
+  return result;
+}
+
+// One result object per line, so a baseline can be read back line by line
+void WriteResults(std::ostream& out, const std::vector<Result>& results) {
+  out << "{\n  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result& r = results[i];
+    out << "    {\"name\": \"" << r.name << "\"";
+    if (!r.skipped.empty()) {
+      out << ", \"skipped\": \"" << r.skipped << "\"";
+    } else if (!r.error.empty()) {
+      out << ", \"error\": \"" << r.error << "\"";
+    } else {
+      out << std::fixed << std::setprecision(2) << ", \"frames\": "
+          << r.frames << ", \"fps\": " << r.fps << ", \"drops\": " << r.drops
+          << ", \"player_cpu_us\": " << r.player_cpu_us
+          << ", \"clone_cpu_us\": " << r.clone_cpu_us
+          << ", \"latency_avg_us\": " << r.latency_avg_us
+          << ", \"latency_p50_us\": " << r.latency_p50_us
+          << ", \"latency_p95_us\": " << r.latency_p95_us
+          << ", \"latency_p99_us\": " << r.latency_p99_us
+          << ", \"latency_max_us\": " << r.latency_max_us;
+    }
+    out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+bool ReadNumber(const std::string& line,
+                const std::string& key,
+                double* value) {
+  const size_t pos = line.find("\"" + key + "\": ");
+  if (pos == std::string::npos) {
+    return false;
+  }
+  *value = strtod(line.c_str() + pos + key.size() + 4, nullptr);
+  return true;
+}
+
+// Reads results written by WriteResults, keyed by name
+std::map<std::string, std::map<std::string, double>> ReadBaseline(
+    const std::string& path) {
+  std::map<std::string, std::map<std::string, double>> baseline;
+  for (const std::string& line : ReadLines(path)) {
+    const size_t pos = line.find("\"name\": \"");
+    if (pos == std::string::npos || line.find("\"error\"") != line.npos ||
+        line.find("\"skipped\"") != line.npos) {
+      continue;
+    }
+    const size_t begin = pos + 9;
+    const std::string name = line.substr(begin, line.find('"', begin) - begin);
+    for (const char* key : {"fps", "drops", "player_cpu_us", "clone_cpu_us",
+                            "latency_p99_us"}) {
+      double value;
+      if (ReadNumber(line, key, &value)) {
+        baseline[name][key] = value;
+      }
+    }
+  }
+  return baseline;
+}
+
+// Prints every metric worse than the baseline beyond the tolerance and
+// returns how many there were. Skipped scenarios are listed but are not
+// regressions.
+int CompareBaseline(const Config& config, const std::vector<Result>& results) {
+  const auto baseline = ReadBaseline(config.baseline);
+  if (baseline.empty()) {
+    std::cout << "No results in baseline " << config.baseline << std::endl;
+    return 0;
+  }
+
+  const double tolerance = config.tolerance / 100;
+  int regressions = 0;
+  int skipped = 0;
+  auto report = [&](const std::string& name, const char* metric,
+                    double value, double base) {
+    std::cout << "REGRESSION " << name << " " << metric << " " << value
+              << " (baseline " << base << ")" << std::endl;
+    regressions++;
+  };
+
+  for (const Result& r : results) {
+    auto it = baseline.find(r.name);
+    if (it == baseline.end()) {
+      continue;
+    }
+    const std::map<std::string, double>& base = it->second;
+    if (!r.skipped.empty()) {
+      std::cout << "SKIPPED " << r.name << " " << r.skipped << std::endl;
+      skipped++;
+      continue;
+    }
+    if (!r.error.empty()) {
+      std::cout << "REGRESSION " << r.name << " " << r.error << std::endl;
+      regressions++;
+      continue;
+    }
+
+    if (r.fps < base.at("fps") * (1 - tolerance)) {
+      report(r.name, "fps", r.fps, base.at("fps"));
+    }
+    if (r.drops > base.at("drops") + config.drop_slack) {
+      report(r.name, "drops", r.drops, base.at("drops"));
+    }
+    for (const char* key : {"player_cpu_us", "clone_cpu_us"}) {
+      const double value =
+          key == std::string("player_cpu_us") ? r.player_cpu_us
+                                              : r.clone_cpu_us;
+      if (value > base.at(key) * (1 + tolerance)) {
+        report(r.name, key, value, base.at(key));
+      }
+    }
+    if (base.at("latency_p99_us") >= 0 && r.latency_p99_us >= 0 &&
+        r.latency_p99_us > base.at("latency_p99_us") * (1 + tolerance)) {
+      report(r.name, "latency_p99_us", r.latency_p99_us,
+             base.at("latency_p99_us"));
+    }
+  }
+  if (skipped) {
+    std::cout << skipped << " scenarios skipped, not compared" << std::endl;
+  }
+  return regressions;
+}
+
+// Reloads the drivers with fixed device numbers and a loopback large
+// enough for 4K
+bool LoadModules() {
+  system("modprobe -r v4l2loopback vivid 2>/dev/null");
+  if (system("modprobe vivid n_devs=1 node_types=0x1 vid_cap_nr=40") != 0) {
+    std::cout << "Could not load vivid" << std::endl;
+    return false;
+  }
+  if (system("modprobe v4l2loopback devices=1 video_nr=41 exclusive_caps=1 "
+             "max_width=3840 max_height=2160 card_label=v4l2_benchmark") !=
+      0) {
+    std::cout << "Could not load v4l2loopback" << std::endl;
+  }
+  // Let udev create the device nodes
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  Config config;
+  ParseCommandLine(argc, argv, config);
+
+  if (config.bin_dir.empty()) {
+    char path[4096] = {};
+    if (readlink("/proc/self/exe", path, sizeof(path) - 1) > 0) {
+      config.bin_dir = path;
+      config.bin_dir.resize(config.bin_dir.rfind('/'));
+    }
+  }
+
+  std::cout << "======" << std::endl;
+  std::cout << "vivid: " << config.vivid_device << std::endl;
+  std::cout << "loopback: " << config.loopback_device << std::endl;
+  std::cout << "load_modules: " << config.load_modules << std::endl;
+  std::cout << "pipelines: " << config.pipelines << std::endl;
+  std::cout << "sizes: " << config.sizes << std::endl;
+  std::cout << "modes: " << config.modes << std::endl;
+  std::cout << "fps: " << config.fps << std::endl;
+  std::cout << "duration: " << config.duration << std::endl;
+  std::cout << "bin_dir: " << config.bin_dir << std::endl;
+  std::cout << "log_dir: " << config.log_dir << std::endl;
+  std::cout << "output: " << config.output << std::endl;
+  std::cout << "baseline: " << config.baseline << std::endl;
+  std::cout << "tolerance: " << config.tolerance << std::endl;
+  std::cout << "drop_slack: " << config.drop_slack << std::endl;
+
+  if (config.load_modules && !LoadModules()) {
+    return -1;
+  }
+  mkdir(config.log_dir.c_str(), 0755);
+
+  std::cout << "======" << std::endl;
+  std::vector<Result> results;
+  for (const std::string& pipeline : SplitList(config.pipelines)) {
+    for (const std::string& size : SplitList(config.sizes)) {
+      for (const std::string& mode : SplitList(config.modes)) {
+        Result result = RunScenario(config, pipeline, size, mode);
+        if (!result.skipped.empty()) {
+          std::cout << std::left << std::setw(28) << result.name
+                    << "skipped, " << result.skipped << std::endl;
+        } else if (result.error.empty()) {
+          std::cout << std::left << std::setw(28) << result.name << std::fixed
+                    << std::setprecision(1) << result.fps << " fps, drops "
+                    << result.drops << ", cpu " << result.player_cpu_us
+                    << " / " << result.clone_cpu_us
+                    << " us/frame, latency p50 " << result.latency_p50_us
+                    << " us p99 " << result.latency_p99_us << " us"
+                    << std::endl;
+        } else {
+          std::cout << std::left << std::setw(28) << result.name
+                    << result.error << std::endl;
+        }
+        results.push_back(result);
+
+        // Give the drivers time to release the devices
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+      }
+    }
+  }
+
+  if (!config.output.empty()) {
+    std::ofstream out(config.output);
+    WriteResults(out, results);
+  } else {
+    WriteResults(std::cout, results);
+  }
+
+  if (!config.baseline.empty() && CompareBaseline(config, results)) {
+    return 1;
+  }
+  return 0;
+}
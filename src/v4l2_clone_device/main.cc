@@ -28,8 +28,14 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include <variant>
 #include <vector>
 
 #include <fcntl.h>
@@ -42,26 +48,115 @@
 
 #include <cxxopts.hpp>
 
-#include "capture_device_mmap.h"
+#include "change_detector.h"
 #include "check.h"
-#include "output_device_dmabuf.h"
-#include "output_device_mmap.h"
-#include "sdl2_video_renderer.h"
+#include "checksum_log.h"
+#include "copy_utils.h"
+#include "dequeue_policy.h"
+#include "frame_pacer.h"
+#include "logger.h"
+#include "rt_utils.h"
+#include "scale_ladder.h"
+#include "startup_timer.h"
+#include "trace.h"
+#include "v4l2_device_cache.h"
+#include "v4l2_device_monitor.h"
+#include "v4l2_stream_device.h"
 #include "v4l2_utils.h"
+#include "video_renderer.h"
+#include "yuv_utils.h"
 
 struct Config {
   std::string capture_device;
   uint32_t video_width;
   uint32_t video_height;
+  uint32_t fps;
 
   std::string output_device;
+  std::string output_format;
+  uint32_t output_width;
+  uint32_t output_height;
+  std::string crop;
+  std::string ladder;
+  uint32_t ladder_threads;
+
+  bool pace;
 
   bool dmabuf;
+  std::string capture_memory;
+  std::string output_memory;
+  V4L2MemoryType capture_memory_type;
+  V4L2MemoryType output_memory_type;
+
+  std::string renderer;
+
+  std::string dequeue;
+  bool drain;
+
+  std::string sched;
+  std::string cpus;
+  bool mlock;
 
   bool not_show_capture;
+
+  double static_threshold;
+  uint32_t static_hold;
+  uint32_t static_keepalive;
+
+  std::string checksum;
+  std::string trace;
+  std::string log_level;
 };
 
-bool g_quit = false;
+// A downscaled copy of the output sent to another device
+struct LadderOutput {
+  std::string device;
+  uint32_t width;
+  uint32_t height;
+
+  int fd = -1;
+  v4l2_pix_format pix_format = {};
+  std::unique_ptr<V4L2Device> output;
+};
+
+// Parses `device:WxH,...` into rungs of even sizes
+bool ParseLadder(const std::string& ladder,
+                 std::vector<LadderOutput>* outputs) {
+  std::stringstream stream(ladder);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    const size_t colon = item.rfind(':');
+    LadderOutput rung;
+    if (colon == std::string::npos ||
+        sscanf(item.c_str() + colon + 1, "%ux%u", &rung.width,
+               &rung.height) != 2 ||
+        !rung.width || !rung.height || rung.width % 2 || rung.height % 2) {
+      std::cout << "Invalid ladder output: " << item << std::endl;
+      return false;
+    }
+    rung.device = item.substr(0, colon);
+    outputs->push_back(std::move(rung));
+  }
+  return true;
+}
+
+// Sets the size of an output format and the stride and size of its single
+// plane layout
+void SetOutputSize(v4l2_pix_format* pix_format,
+                   uint32_t width,
+                   uint32_t height) {
+  pix_format->width = width;
+  pix_format->height = height;
+  if (pix_format->pixelformat == V4L2_PIX_FMT_YUYV) {
+    pix_format->bytesperline = width * 2;
+    pix_format->sizeimage = pix_format->bytesperline * height;
+  } else {
+    pix_format->bytesperline = width;
+    pix_format->sizeimage = pix_format->bytesperline * height * 3 / 2;
+  }
+}
+
+std::atomic<bool> g_quit = false;
 void sighandler(int) {
   if (!g_quit) {
     g_quit = true;
@@ -84,19 +179,99 @@ void ParseCommandLine(int argc, char** argv, Config& config) {
                             cxxopts::value<uint32_t>()->default_value("640")});
     options.add_option("", {"height", "Specify capture video height",
                             cxxopts::value<uint32_t>()->default_value("360")});
+    options.add_option(
+        "", {"fps", "Specify capture frame rate (default: device default)",
+             cxxopts::value<uint32_t>()->default_value("0")});
     options.add_option(
         "", {"o, output", "Specify output device",
              cxxopts::value<std::string>()->default_value("/dev/video2")});
+    options.add_option(
+        "", {"output_format", "Output pixel format: yuyv, nv12 or i420",
+             cxxopts::value<std::string>()->default_value("yuyv")});
+    options.add_option(
+        "", {"output_width", "Output width (default: capture width)",
+             cxxopts::value<uint32_t>()->default_value("0")});
+    options.add_option(
+        "", {"output_height", "Output height (default: capture height)",
+             cxxopts::value<uint32_t>()->default_value("0")});
+    options.add_option(
+        "", {"crop", "Send only the region x,y,w,h of the capture frame",
+             cxxopts::value<std::string>()->default_value("")});
+    options.add_option(
+        "", {"ladder",
+             "Also send downscaled copies of the output, each scaled from "
+             "the one before, to device:WxH,...",
+             cxxopts::value<std::string>()->default_value("")});
+    options.add_option(
+        "", {"ladder_threads", "Threads scaling each ladder level",
+             cxxopts::value<uint32_t>()->default_value("2")});
     options.add_option(
         "",
         {"dmabuf", "Use DMABUF for output device enqueuing (default: false)",
          cxxopts::value<bool>()->default_value("false")->implicit_value(
              "true")});
+    options.add_option(
+        "", {"capture_memory",
+             "Capture buffer memory: mmap, expbuf, dmabuf or userptr",
+             cxxopts::value<std::string>()->default_value("mmap")});
+    options.add_option(
+        "", {"output_memory",
+             "Output buffer memory: mmap, expbuf, dmabuf or userptr",
+             cxxopts::value<std::string>()->default_value("mmap")});
+    options.add_option(
+        "", {"pace",
+             "Release output frames at a steady frame rate (default: false)",
+             cxxopts::value<bool>()->default_value("false")->implicit_value(
+                 "true")});
     options.add_option(
         "", {"not_show", "Do not show capture stream",
              cxxopts::value<bool>()->default_value("false")->implicit_value(
                  "true")});
 
+    options.add_option(
+        "", {"static_threshold",
+             "Skip static frames below this mean luma change, 0 for off",
+             cxxopts::value<double>()->default_value("0")});
+    options.add_option(
+        "", {"static_hold", "Frames below the threshold before skipping",
+             cxxopts::value<uint32_t>()->default_value("30")});
+    options.add_option(
+        "", {"static_keepalive", "Forward every Nth static frame, 0 for none",
+             cxxopts::value<uint32_t>()->default_value("30")});
+
+    options.add_option(
+        "", {"checksum", "Write capture frame checksums to a log file",
+             cxxopts::value<std::string>()->default_value("")});
+    options.add_option(
+        "", {"trace", "Write a Chrome trace here, toggled with SIGUSR1",
+             cxxopts::value<std::string>()->default_value("")});
+    options.add_option(
+        "", {"log_level", "Log level: debug, info, warning or error",
+             cxxopts::value<std::string>()->default_value("info")});
+    options.add_option(
+        "", {"renderer", "Preview backend: sdl, offscreen or null",
+             cxxopts::value<std::string>()->default_value("sdl")});
+
+    options.add_option(
+        "", {"dequeue", "Capture wait mode: block, spin or busy",
+             cxxopts::value<std::string>()->default_value("block")});
+
+    options.add_option(
+        "", {"drain",
+             "Skip to the newest ready frame when behind (default: false)",
+             cxxopts::value<bool>()->default_value("false")->implicit_value(
+                 "true")});
+    options.add_option(
+        "", {"sched", "Thread scheduling: other, fifo:<prio> or deadline",
+             cxxopts::value<std::string>()->default_value("other")});
+    options.add_option(
+        "", {"cpus", "Pin the streaming thread to CPUs, e.g. 2,3 or 2-5",
+             cxxopts::value<std::string>()->default_value("")});
+    options.add_option(
+        "", {"mlock", "Lock memory and prefault buffers (default: false)",
+             cxxopts::value<bool>()->default_value("false")->implicit_value(
+                 "true")});
+
     auto result = options.parse(argc, argv);
 
     if (result.count("help")) {
@@ -107,9 +282,48 @@ void ParseCommandLine(int argc, char** argv, Config& config) {
     config.capture_device = result["input"].as<std::string>();
     config.video_width = result["width"].as<uint32_t>();
     config.video_height = result["height"].as<uint32_t>();
+    config.fps = result["fps"].as<uint32_t>();
     config.output_device = result["output"].as<std::string>();
+    config.output_format = result["output_format"].as<std::string>();
+    config.output_width = result["output_width"].as<uint32_t>();
+    config.output_height = result["output_height"].as<uint32_t>();
+    config.crop = result["crop"].as<std::string>();
+    config.ladder = result["ladder"].as<std::string>();
+    config.ladder_threads = result["ladder_threads"].as<uint32_t>();
+    config.pace = result["pace"].as<bool>();
     config.dmabuf = result["dmabuf"].as<bool>();
+    config.capture_memory = result["capture_memory"].as<std::string>();
+    config.output_memory = result["output_memory"].as<std::string>();
+    config.static_threshold = result["static_threshold"].as<double>();
+    config.static_hold = result["static_hold"].as<uint32_t>();
+    config.static_keepalive = result["static_keepalive"].as<uint32_t>();
+    config.checksum = result["checksum"].as<std::string>();
+    config.trace = result["trace"].as<std::string>();
+    config.log_level = result["log_level"].as<std::string>();
+    config.renderer = result["renderer"].as<std::string>();
+    config.dequeue = result["dequeue"].as<std::string>();
+    config.drain = result["drain"].as<bool>();
+    config.sched = result["sched"].as<std::string>();
+    config.cpus = result["cpus"].as<std::string>();
+    config.mlock = result["mlock"].as<bool>();
     config.not_show_capture = result["not_show"].as<bool>();
+
+    // --dmabuf predates --output_memory
+    if (config.dmabuf) {
+      config.output_memory = "dmabuf";
+    }
+    if (!v4l2_parse_memory_type(config.capture_memory,
+                                &config.capture_memory_type)) {
+      std::cout << "Invalid capture memory: " << config.capture_memory
+                << std::endl;
+      exit(-1);
+    }
+    if (!v4l2_parse_memory_type(config.output_memory,
+                                &config.output_memory_type)) {
+      std::cout << "Invalid output memory: " << config.output_memory
+                << std::endl;
+      exit(-1);
+    }
   } catch (const cxxopts::exceptions::exception& e) {
     std::cout << "error parsing options: " << e.what() << std::endl;
     exit(-1);
@@ -128,109 +342,818 @@ int main(int argc, char* argv[]) {
   std::cout << "not_show_capture: " << config.not_show_capture << std::endl;
   std::cout << "video_width: " << config.video_width << std::endl;
   std::cout << "video_height: " << config.video_height << std::endl;
+  std::cout << "fps: " << config.fps << std::endl;
   std::cout << "output_device: " << config.output_device << std::endl;
+  std::cout << "output_format: " << config.output_format << std::endl;
+  std::cout << "output_width: " << config.output_width << std::endl;
+  std::cout << "output_height: " << config.output_height << std::endl;
+  std::cout << "crop: " << config.crop << std::endl;
+  std::cout << "ladder: " << config.ladder << std::endl;
+  std::cout << "ladder_threads: " << config.ladder_threads << std::endl;
+  std::cout << "pace: " << config.pace << std::endl;
   std::cout << "dmabuf: " << config.dmabuf << std::endl;
+  std::cout << "capture_memory: " << config.capture_memory << std::endl;
+  std::cout << "output_memory: " << config.output_memory << std::endl;
+  std::cout << "static_threshold: " << config.static_threshold << std::endl;
+  std::cout << "static_hold: " << config.static_hold << std::endl;
+  std::cout << "static_keepalive: " << config.static_keepalive << std::endl;
+  std::cout << "checksum: " << config.checksum << std::endl;
+  std::cout << "trace: " << config.trace << std::endl;
+  std::cout << "log_level: " << config.log_level << std::endl;
+  std::cout << "renderer: " << config.renderer << std::endl;
+  std::cout << "dequeue: " << config.dequeue << std::endl;
+  std::cout << "drain: " << config.drain << std::endl;
+  std::cout << "sched: " << config.sched << std::endl;
+  std::cout << "cpus: " << config.cpus << std::endl;
+  std::cout << "mlock: " << config.mlock << std::endl;
 
-  // Open and initialize capture device
-  std::cout << "======" << std::endl;
-  int capture_fd = open(config.capture_device.c_str(), O_RDWR);
-  if (capture_fd < 0) {
-    std::cout << "Invalid device: " << config.capture_device << std::endl;
+  if (!config.trace.empty() && !Trace::Initialize(config.trace)) {
     return -1;
   }
 
-  v4l2_pix_format capture_pix_format = {};
-  capture_pix_format.pixelformat = kPixFormat;
-  capture_pix_format.width = config.video_width;
-  capture_pix_format.height = config.video_height;
+  LogLevel log_level;
+  if (!Logger::ParseLevel(config.log_level, &log_level)) {
+    std::cout << "Invalid log level: " << config.log_level << std::endl;
+    return -1;
+  }
+  Logger::Initialize(log_level);
 
-  if (!v4l2_set_pix_format(capture_fd, V4L2_BUF_TYPE_VIDEO_CAPTURE,
-                           &capture_pix_format)) {
+  VideoRenderer::Backend renderer_backend;
+  if (!VideoRenderer::ParseBackend(config.renderer, &renderer_backend)) {
+    std::cout << "Invalid renderer: " << config.renderer << std::endl;
     return -1;
   }
 
-  // Create capture v4l2 device
-  std::unique_ptr<V4L2Device> capture = std::make_unique<CaptureDeviceMmap>(
-      capture_fd, config.video_width, config.video_height, false);
-  capture->Initialize(kBufferCount);
-  capture->Start();
+  uint32_t output_fourcc;
+  if (config.output_format == "yuyv") {
+    output_fourcc = V4L2_PIX_FMT_YUYV;
+  } else if (config.output_format == "nv12") {
+    output_fourcc = V4L2_PIX_FMT_NV12;
+  } else if (config.output_format == "i420") {
+    output_fourcc = V4L2_PIX_FMT_YUV420;
+  } else {
+    std::cout << "Invalid output format: " << config.output_format
+              << std::endl;
+    return -1;
+  }
+  if (config.output_width % 2 || config.output_height % 2) {
+    std::cout << "Output size must be even" << std::endl;
+    return -1;
+  }
+
+  // Region of the capture frame sent to the output. YUYV pairs pixels, so
+  // its horizontal edges must be even.
+  v4l2_rect crop_rect = {};
+  const bool crop = !config.crop.empty();
+  if (crop) {
+    const int parsed =
+        sscanf(config.crop.c_str(), "%d,%d,%u,%u", &crop_rect.left,
+               &crop_rect.top, &crop_rect.width, &crop_rect.height);
+    if (parsed != 4 || crop_rect.left < 0 || crop_rect.top < 0 ||
+        !crop_rect.width || !crop_rect.height || crop_rect.left % 2 ||
+        crop_rect.width % 2) {
+      std::cout << "Invalid crop: " << config.crop << std::endl;
+      return -1;
+    }
+  }
 
-  // Open and initialize output device
+  std::vector<LadderOutput> ladder_outputs;
+  if (!ParseLadder(config.ladder, &ladder_outputs)) {
+    return -1;
+  }
+
+  DequeuePolicy::Mode dequeue_mode;
+  if (!DequeuePolicy::ParseMode(config.dequeue, &dequeue_mode)) {
+    std::cout << "Invalid dequeue mode: " << config.dequeue << std::endl;
+    return -1;
+  }
+
+  RtProfile rt_profile;
+  if (!rt_parse_profile(config.sched, config.cpus, config.mlock,
+                        &rt_profile) ||
+      !rt_lock_memory(rt_profile)) {
+    return -1;
+  }
+
+  // Open capture device
   std::cout << "======" << std::endl;
-  int output_fd = open(config.output_device.c_str(), O_RDWR);
-  if (output_fd < 0) {
-    std::cout << "Invalid device: " << config.output_device << std::endl;
+  int capture_fd;
+  {
+    ScopedStartupTimer timer("capture open");
+    capture_fd = open(config.capture_device.c_str(), O_RDWR);
+  }
+  if (capture_fd < 0) {
+    std::cout << "Invalid device: " << config.capture_device << std::endl;
     return -1;
   }
-  // Set capture pix format to output device
-  [[maybe_unused]] v4l2_pix_format output_pix_format = capture_pix_format;
-  if (!v4l2_set_pix_format(output_fd, V4L2_BUF_TYPE_VIDEO_OUTPUT,
-                           &capture_pix_format)) {
+  V4L2DeviceInfo capture_info;
+  if (!v4l2_query_capability(capture_fd, &capture_info)) {
     return -1;
   }
 
-  // Create output v4l2 device
+  // Bring up the capture device, the output device and the renderer
+  // concurrently. The output device only waits for the negotiated capture
+  // format; the renderer stays on the main thread, which renders later.
+  v4l2_pix_format capture_pix_format = {};
+  v4l2_fract timeperframe = {};
+
+  // With a crop, the full-frame capture format, whether the capture device
+  // crops itself and otherwise where the region starts in a capture frame
+  v4l2_pix_format full_pix_format = {};
+  bool hardware_crop = false;
+  size_t crop_offset = 0;
+
+  // Asks the sensor or ISP to crop so only the region is transferred; the
+  // capture format then shrinks to the region. `fd` must be set to the full
+  // frame format.
+  auto set_hardware_crop = [&](int fd) {
+    v4l2_pix_format pix_format = full_pix_format;
+    pix_format.width = crop_rect.width;
+    pix_format.height = crop_rect.height;
+    pix_format.bytesperline = 0;
+    pix_format.sizeimage = 0;
+    if (!v4l2_set_crop(fd, V4L2_BUF_TYPE_VIDEO_CAPTURE, crop_rect) ||
+        !v4l2_set_pix_format(fd, V4L2_BUF_TYPE_VIDEO_CAPTURE, &pix_format)) {
+      return false;
+    }
+    capture_pix_format = pix_format;
+    return true;
+  };
+
+  std::unique_ptr<V4L2Device> capture;
+  std::promise<bool> capture_format_promise;
+  std::future<bool> capture_format_ready = capture_format_promise.get_future();
+
+  std::future<bool> capture_ready = std::async(std::launch::async, [&]() {
+    auto set_capture_format = [&]() {
+      // Choose the capture mode from the cached device capabilities
+      if (!v4l2_select_capture_mode(capture_fd, kPixFormat,
+                                    &config.video_width,
+                                    &config.video_height)) {
+        return false;
+      }
+
+      capture_pix_format.pixelformat = kPixFormat;
+      capture_pix_format.width = config.video_width;
+      capture_pix_format.height = config.video_height;
+      if (!v4l2_set_pix_format(capture_fd, V4L2_BUF_TYPE_VIDEO_CAPTURE,
+                               &capture_pix_format)) {
+        return false;
+      }
+      if (!crop) {
+        return true;
+      }
+
+      if (crop_rect.left + crop_rect.width > config.video_width ||
+          crop_rect.top + crop_rect.height > config.video_height) {
+        std::cout << "Crop outside of " << config.video_width << "x"
+                  << config.video_height << std::endl;
+        return false;
+      }
+      full_pix_format = capture_pix_format;
+      hardware_crop = set_hardware_crop(capture_fd);
+      if (hardware_crop) {
+        std::cout << "Crop in the capture device" << std::endl;
+        config.video_width = crop_rect.width;
+        config.video_height = crop_rect.height;
+        return true;
+      }
+
+      // Copy only the region out of full frames instead
+      std::cout << "Crop in software" << std::endl;
+      v4l2_reset_crop(capture_fd, V4L2_BUF_TYPE_VIDEO_CAPTURE);
+      capture_pix_format = full_pix_format;
+      if (!v4l2_set_pix_format(capture_fd, V4L2_BUF_TYPE_VIDEO_CAPTURE,
+                               &capture_pix_format)) {
+        return false;
+      }
+      crop_offset = size_t(crop_rect.top) * capture_pix_format.bytesperline +
+                    crop_rect.left * 2;
+      return true;
+    };
+
+    bool ok = set_capture_format();
+    capture_format_promise.set_value(ok);
+    if (!ok) {
+      return false;
+    }
+
+    if (config.fps) {
+      if (!v4l2_set_frame_rate(capture_fd, config.fps, &timeperframe)) {
+        return false;
+      }
+    }
+
+    // Create capture v4l2 device
+    capture = v4l2_create_capture_device(config.capture_memory_type,
+                                         capture_fd, config.video_width,
+                                         config.video_height);
+    capture->Initialize(kBufferCount);
+    if (rt_profile.lock_memory) {
+      capture->Prefault();
+    }
+    capture->Start();
+    return true;
+  });
+
+  int output_fd = -1;
+  V4L2DeviceInfo output_info;
+  v4l2_pix_format output_pix_format = {};
   std::unique_ptr<V4L2Device> output;
-  if (config.dmabuf) {
-    output = std::make_unique<OutputDeviceDmabuf>(output_fd, config.video_width,
-                                                  config.video_height);
-  } else {
-    output = std::make_unique<OutputDeviceMmap>(output_fd, config.video_width,
-                                                config.video_height);
-  }
-  output->Initialize(kBufferCount);
-  output->Start();
+
+  // The output carries the crop region, or the whole capture frame, in
+  // the output format and size when given
+  auto get_output_format = [&]() {
+    v4l2_pix_format pix_format = capture_pix_format;
+    if (crop) {
+      pix_format.width = crop_rect.width;
+      pix_format.height = crop_rect.height;
+      pix_format.bytesperline = crop_rect.width * 2;
+      pix_format.sizeimage = pix_format.bytesperline * crop_rect.height;
+    }
+    if (output_fourcc == kPixFormat && !config.output_width &&
+        !config.output_height) {
+      return pix_format;
+    }
+
+    pix_format.pixelformat = output_fourcc;
+    SetOutputSize(&pix_format,
+                  config.output_width ? config.output_width : pix_format.width,
+                  config.output_height ? config.output_height
+                                       : pix_format.height);
+    return pix_format;
+  };
+
+  std::future<bool> output_ready = std::async(std::launch::async, [&]() {
+    {
+      ScopedStartupTimer timer("output open");
+      output_fd = open(config.output_device.c_str(), O_RDWR);
+    }
+    if (output_fd < 0) {
+      std::cout << "Invalid device: " << config.output_device << std::endl;
+      return false;
+    }
+    if (!v4l2_query_capability(output_fd, &output_info)) {
+      return false;
+    }
+
+    // Set capture pix format to output device
+    if (!capture_format_ready.get()) {
+      return false;
+    }
+    output_pix_format = get_output_format();
+    if (!v4l2_set_pix_format(output_fd, V4L2_BUF_TYPE_VIDEO_OUTPUT,
+                             &output_pix_format)) {
+      return false;
+    }
+
+    // Create output v4l2 device
+    output = v4l2_create_output_device(config.output_memory_type, output_fd,
+                                       output_pix_format.width,
+                                       output_pix_format.height);
+    output->Initialize(kBufferCount);
+    if (rt_profile.lock_memory) {
+      output->Prefault();
+    }
+    output->Start();
+    return true;
+  });
 
   // Create renderer with default windows 640x360
-  std::unique_ptr<SDL2VideoRenderer> renderer;
+  std::unique_ptr<VideoRenderer> renderer;
   if (!config.not_show_capture) {
-    renderer = std::make_unique<SDL2VideoRenderer>(
-        v4l2_get_device_name(capture_fd).c_str());
+    ScopedStartupTimer timer("renderer creation");
+    renderer = VideoRenderer::Create(renderer_backend,
+                                     capture_info.card.c_str());
   }
 
-  uint32_t frames = 0;
-  signal(SIGINT, sighandler);
-  while (!g_quit) {
-    // Acquire capture buffer
-    if (!v4l2_poll(capture_fd, POLLIN)) {
-      std::cout << "Capture device stopped!\n";
-      break;
+  const bool capture_ok = capture_ready.get();
+  const bool output_ok = output_ready.get();
+  if (!capture_ok || !output_ok) {
+    return -1;
+  }
+  if (renderer && rt_profile.lock_memory) {
+    renderer->Reserve(config.video_width, config.video_height);
+  }
+
+  // Open the ladder devices in the output format, each rung no larger than
+  // the one above it. The scaling workers start here, before the streaming
+  // thread's scheduling class and pinning are applied.
+  std::unique_ptr<ScaleLadder> ladder;
+  v4l2_pix_format above_pix_format = output_pix_format;
+  for (LadderOutput& rung : ladder_outputs) {
+    if (rung.width > above_pix_format.width ||
+        rung.height > above_pix_format.height) {
+      std::cout << "Ladder output " << rung.device << " larger than "
+                << above_pix_format.width << "x" << above_pix_format.height
+                << std::endl;
+      return -1;
+    }
+    rung.fd = open(rung.device.c_str(), O_RDWR);
+    if (rung.fd < 0) {
+      std::cout << "Invalid device: " << rung.device << std::endl;
+      return -1;
+    }
+    rung.pix_format = output_pix_format;
+    SetOutputSize(&rung.pix_format, rung.width, rung.height);
+    if (!v4l2_set_pix_format(rung.fd, V4L2_BUF_TYPE_VIDEO_OUTPUT,
+                             &rung.pix_format)) {
+      return -1;
+    }
+
+    rung.output =
+        v4l2_create_output_device(config.output_memory_type, rung.fd,
+                                  rung.pix_format.width,
+                                  rung.pix_format.height);
+    rung.output->Initialize(kBufferCount);
+    if (rt_profile.lock_memory) {
+      rung.output->Prefault();
+    }
+    rung.output->Start();
+    std::cout << "Ladder " << rung.device << ": " << rung.pix_format.width
+              << "x" << rung.pix_format.height << std::endl;
+    above_pix_format = rung.pix_format;
+  }
+  if (!ladder_outputs.empty()) {
+    ladder = std::make_unique<ScaleLadder>(output_pix_format.pixelformat,
+                                           config.ladder_threads);
+  }
+  // Wait for a lost output device to come back, e.g. after the loopback
+  // module was reloaded, and resume with the dmabufs already allocated
+  auto recover_output = [&]() {
+    std::cout << "Output device lost, waiting for " << output_info.bus_info
+              << std::endl;
+    output->Release();
+    close(output_fd);
+    output_fd = -1;
+
+    V4L2DeviceMonitor monitor;
+    while (!g_quit && output_fd < 0) {
+      output_fd = monitor.WaitForDevice(config.output_device,
+                                        output_info.bus_info,
+                                        V4L2_CAP_VIDEO_OUTPUT, 100);
+    }
+    if (output_fd < 0) {
+      return false;
+    }
+
+    output_pix_format = get_output_format();
+    if (!v4l2_set_pix_format(output_fd, V4L2_BUF_TYPE_VIDEO_OUTPUT,
+                             &output_pix_format)) {
+      return false;
     }
-    V4L2DeviceBuffer capture_buffer = capture->Dequeue();
+    output->Reopen(output_fd);
+
+    std::cout << "Output device recovered\n";
+    return true;
+  };
+
+  // Checksum what is sent, keyed by capture sequence, and verify what
+  // landed in the output buffer against it. Repeats of a held frame are
+  // logged under the sequence of the frame they repeat.
+  std::unique_ptr<ChecksumLog> capture_checksums;
+  std::unique_ptr<ChecksumLog> output_checksums;
+  uint64_t checksum_mismatches = 0;
+  LogRateLimiter mismatch_limiter(1);
+  if (!config.checksum.empty()) {
+    capture_checksums = std::make_unique<ChecksumLog>(config.checksum);
+    if (!capture_checksums->IsOpen()) {
+      return -1;
+    }
+    output_checksums = std::make_unique<ChecksumLog>("");
+  }
+
+  // Size of the part of each capture frame that is sent, and whether it
+  // needs converting to the output format and size
+  const uint32_t region_width = crop ? crop_rect.width : config.video_width;
+  const uint32_t region_height = crop ? crop_rect.height : config.video_height;
+  const bool convert_output = output_pix_format.pixelformat != kPixFormat ||
+                              output_pix_format.width != region_width ||
+                              output_pix_format.height != region_height;
+  YuvScratch convert_scratch;
+  if (convert_output) {
+    std::cout << "Convert " << region_width << "x" << region_height << " "
+              << v4l2_fourcc_to_string(kPixFormat) << " to "
+              << output_pix_format.width << "x" << output_pix_format.height
+              << " " << v4l2_fourcc_to_string(output_pix_format.pixelformat)
+              << std::endl;
+  }
+
+  // Forward static scenes at a keep-alive rate only
+  std::unique_ptr<ChangeDetector> change_detector;
+  if (config.static_threshold > 0) {
+    change_detector = std::make_unique<ChangeDetector>(
+        V4L2_PIX_FMT_YUYV, region_width, region_height,
+        config.static_threshold, config.static_hold, config.static_keepalive);
+  }
+
+  // Capture, output and render all run on this thread
+  if (rt_profile.sched == RtProfile::Sched::kDeadline &&
+      !timeperframe.denominator) {
+    v4l2_get_frame_rate(capture_fd, &timeperframe);
+  }
+  if (!rt_apply_thread(rt_profile, "capture/output", timeperframe)) {
+    return -1;
+  }
+  Trace::SetThreadName("capture/output");
 
-    // Acquire output buffer
-    if (!v4l2_poll(output_fd, POLLOUT)) {
-      std::cout << "Output device stopped!\n";
-      break;
+  std::unique_ptr<FramePacer> pacer;
+  if (config.pace) {
+    if (!timeperframe.denominator &&
+        !v4l2_get_frame_rate(capture_fd, &timeperframe)) {
+      std::cout << "Unknown capture frame rate, specify --fps\n";
+      return -1;
     }
-    V4L2DeviceBuffer output_buffer = output->Dequeue();
+    pacer = std::make_unique<FramePacer>(timeperframe);
+    pacer->Start();
+  }
+
+  DequeuePolicy dequeue_policy(dequeue_mode, &g_quit);
+  uint64_t discarded_frames = 0;
+  if (timeperframe.denominator ||
+      v4l2_get_frame_rate(capture_fd, &timeperframe)) {
+    dequeue_policy.SetFrameInterval(timeperframe);
+  }
+
+  uint32_t frames = 0;
+  signal(SIGINT, sighandler);
+
+  // Stream with both devices as their own types, without virtual calls
+  auto stream = [&](auto* capture_device, auto* output_device) {
+    using CaptureDevice = std::remove_pointer_t<decltype(capture_device)>;
+    using OutputDevice = std::remove_pointer_t<decltype(output_device)>;
+
+    // Ladder devices are created like the output device, so share its type
+    std::vector<BasicBufferLease<OutputDevice>> ladder_leases(
+        ladder_outputs.size());
+    std::vector<ScaleLadder::Level> ladder_levels;
+    ladder_levels.reserve(ladder_outputs.size());
+
+    // Scales the ladder from the output frame just written, each rung
+    // straight into a buffer of its device. A lost ladder device is dropped
+    // and the rungs below it scale from the one above.
+    auto send_ladder = [&](uint8_t* output_data, uint64_t timestamp_us,
+                           uint32_t sequence) {
+      ladder_levels.clear();
+      for (size_t i = 0; i < ladder_outputs.size(); i++) {
+        LadderOutput& rung = ladder_outputs[i];
+        if (!rung.output) {
+          continue;
+        }
+        if (v4l2_poll(rung.fd, POLLOUT)) {
+          ladder_leases[i] =
+              static_cast<OutputDevice*>(rung.output.get())->Lease();
+        }
+        if (!ladder_leases[i]) {
+          Log(LogLevel::kWarning) << "Ladder device lost: " << rung.device;
+          rung.output->Release();
+          rung.output.reset();
+          close(rung.fd);
+          rung.fd = -1;
+          continue;
+        }
+
+        V4L2DeviceBuffer& buffer = *ladder_leases[i];
+        CHECK(buffer.len >= rung.pix_format.sizeimage);
+        ladder_levels.push_back(
+            {(uint8_t*)buffer.data, rung.pix_format.bytesperline,
+             rung.pix_format.width, rung.pix_format.height});
+      }
+
+      {
+        ScopedTrace trace("ladder", sequence);
+        ladder->Scale({output_data, output_pix_format.bytesperline,
+                       output_pix_format.width, output_pix_format.height},
+                      ladder_levels);
+      }
+
+      for (auto& lease : ladder_leases) {
+        if (lease) {
+          lease->timestamp_us = timestamp_us;
+          lease.Reset();
+        }
+      }
+    };
+
+    // Copy a capture frame into the next free output buffer
+    uint32_t output_frames = 0;
+    auto send_frame = [&](const V4L2DeviceBuffer& capture_buffer) {
+      // Only the rows and columns of the crop region are touched from here on
+      const uint8_t* region = (const uint8_t*)capture_buffer.data + crop_offset;
+
+      if (change_detector &&
+          !change_detector->Update(region, capture_pix_format.bytesperline)) {
+        return true;
+      }
+
+      if (!v4l2_poll(output_fd, POLLOUT)) {
+        Log(LogLevel::kError) << "Output device stopped!";
+        return false;
+      }
+      auto output_lease = output_device->Lease();
+      if (!output_lease) {
+        return recover_output();
+      }
+      V4L2DeviceBuffer& output_buffer = *output_lease;
+      CHECK(output_buffer.len >= output_pix_format.sizeimage);
+      uint8_t* output_data = (uint8_t*)output_buffer.data;
+
+      if (!convert_output) {
+        // The output is never read back by the CPU, so stream it past the
+        // cache
+        ScopedTrace trace("copy", capture_buffer.sequence);
+        copy_plane(output_data, output_pix_format.bytesperline, region,
+                   capture_pix_format.bytesperline, region_width * 2,
+                   region_height);
+      } else {
+        // Convert and scale straight into the output buffer
+        ScopedTrace trace("convert", capture_buffer.sequence);
+        yuv_convert_yuy2(region, capture_pix_format.bytesperline, region_width,
+                         region_height, output_pix_format.pixelformat,
+                         output_data, output_pix_format.bytesperline,
+                         output_pix_format.width, output_pix_format.height,
+                         &convert_scratch);
+      }
+
+      if (capture_checksums && !convert_output) {
+        const uint32_t sent = capture_checksums->Add(
+            capture_buffer.sequence, region, capture_pix_format.bytesperline,
+            region_width * 2, region_height);
+        const uint32_t written =
+            output_checksums->Add(capture_buffer.sequence, output_data,
+                                  output_pix_format.bytesperline,
+                                  region_width * 2, region_height);
+        if (sent != written) {
+          checksum_mismatches++;
+          Log(LogLevel::kError, &mismatch_limiter)
+              << "Output frame " << output_frames
+              << " does not match capture frame " << capture_buffer.sequence;
+        }
+      } else if (capture_checksums) {
+        // A converted frame has no reference to verify against; log the
+        // first plane of what is sent
+        const uint32_t luma_bytes =
+            output_pix_format.width *
+            (output_pix_format.pixelformat == V4L2_PIX_FMT_YUYV ? 2 : 1);
+        capture_checksums->Add(capture_buffer.sequence, output_data,
+                               output_pix_format.bytesperline, luma_bytes,
+                               output_pix_format.height);
+      }
+
+      if (ladder) {
+        send_ladder(output_data, capture_buffer.timestamp_us,
+                    capture_buffer.sequence);
+      }
 
-    // Copy video frame
-    CHECK(output_buffer.len >= capture_buffer.len);
-    memcpy(output_buffer.data, capture_buffer.data, capture_buffer.len);
+      // Pass the capture time on, so consumers can measure end-to-end latency
+      output_buffer.timestamp_us = capture_buffer.timestamp_us;
+      output_lease.Reset();
+      if (output_frames++ == 0) {
+        StartupTimer::Mark("first output QBUF");
+      }
+      return true;
+    };
 
-    // Return output buffer
-    output->Queue(output_buffer);
+    // The newest capture buffer is held until the next one arrives, so the
+    // last good frame is still readable when the capture device is lost
+    BasicBufferLease<CaptureDevice> held_buffer;
 
-    // Render
-    if (renderer) {
-      renderer->RenderFrameYUY2(config.video_width, config.video_height,
-                                (uint8_t*)capture_buffer.data,
-                                capture_pix_format.bytesperline);
+    // Wait for a lost capture device to come back and renegotiate the same
+    // format, feeding the output with the last good frame meanwhile so
+    // consumers do not stall
+    auto recover_capture = [&]() {
+      Log(LogLevel::kWarning) << "Capture device lost, waiting for "
+                              << capture_info.bus_info;
+
+      std::vector<uint8_t> last_frame;
+      uint32_t last_sequence = 0;
+      if (held_buffer) {
+        const uint8_t* data = static_cast<const uint8_t*>(held_buffer->data);
+        last_frame.assign(data, data + held_buffer->len);
+        last_sequence = held_buffer->sequence;
+        held_buffer.Reset();
+      }
+      capture->Release();
+      close(capture_fd);
+      capture_fd = -1;
+
+      int interval_ms = 33;
+      if (timeperframe.denominator) {
+        interval_ms = std::max<int>(
+            1, 1000 * timeperframe.numerator / timeperframe.denominator);
+      }
+
+      // The monitor also wakes up for unrelated devices, so the repeats
+      // follow their own schedule of one per frame interval
+      const auto interval = std::chrono::milliseconds(interval_ms);
+      auto next_repeat = std::chrono::steady_clock::now() + interval;
+      V4L2DeviceMonitor monitor;
+      while (!g_quit && capture_fd < 0) {
+        auto now = std::chrono::steady_clock::now();
+        const int timeout_ms = std::max<int>(
+            1, std::chrono::ceil<std::chrono::milliseconds>(next_repeat - now)
+                   .count());
+        capture_fd = monitor.WaitForDevice(config.capture_device,
+                                           capture_info.bus_info,
+                                           V4L2_CAP_VIDEO_CAPTURE, timeout_ms);
+
+        now = std::chrono::steady_clock::now();
+        if (capture_fd < 0 && now >= next_repeat) {
+          next_repeat += interval;
+          if (next_repeat <= now) {
+            next_repeat = now + interval;
+          }
+          if (!last_frame.empty()) {
+            V4L2DeviceBuffer last_buffer = {};
+            last_buffer.data = last_frame.data();
+            last_buffer.len = last_frame.size();
+            last_buffer.sequence = last_sequence;
+            if (!send_frame(last_buffer)) {
+              return false;
+            }
+          }
+        }
+      }
+      if (capture_fd < 0) {
+        return false;
+      }
+
+      v4l2_pix_format pix_format =
+          hardware_crop ? full_pix_format : capture_pix_format;
+      if (!v4l2_set_pix_format(capture_fd, V4L2_BUF_TYPE_VIDEO_CAPTURE,
+                               &pix_format)) {
+        return false;
+      }
+      if (hardware_crop && !set_hardware_crop(capture_fd)) {
+        return false;
+      }
+      if (config.fps &&
+          !v4l2_set_frame_rate(capture_fd, config.fps, &timeperframe)) {
+        return false;
+      }
+      capture->Reopen(capture_fd);
+      if (pacer) {
+        pacer->Start();
+      }
+
+      Log(LogLevel::kInfo) << "Capture device recovered";
+      return true;
+    };
+
+    bool first_send = true;
+    while (pacer && !g_quit) {
+      pollfd pfds[2] = {};
+      pfds[0].fd = capture_fd;
+      pfds[0].events = POLLIN;
+      pfds[1].fd = pacer->GetFd();
+      pfds[1].events = POLLIN;
+      if (poll(pfds, 2, -1) < 0) {
+        Log(LogLevel::kError) << "Capture device stopped!";
+        break;
+      }
+
+      // Hold the newest capture buffer until the next tick, returning the one
+      // it replaces
+      if (pfds[0].revents & (POLLIN | POLLERR)) {
+        auto capture_lease = capture_device->Lease();
+        if (!capture_lease) {
+          if (!recover_capture()) {
+            break;
+          }
+          continue;
+        }
+        if (frames == 0) {
+          StartupTimer::Mark("first DQBUF");
+        }
+
+        if (renderer) {
+          renderer->RenderFrameYUY2(config.video_width, config.video_height,
+                                    (uint8_t*)capture_lease->data,
+                                    capture_pix_format.bytesperline);
+          if (frames == 0) {
+            StartupTimer::Mark("first render");
+          }
+        }
+
+        held_buffer = std::move(capture_lease);
+        pacer->OnFrame();
+
+        ++frames;
+        if (frames % 100 == 0) {
+          LogMessage message(LogLevel::kInfo);
+          message << "Frames " << frames << ", duplicated "
+                  << pacer->GetDuplicatedFrames() << ", dropped "
+                  << pacer->GetDroppedFrames() << ", late ticks "
+                  << pacer->GetLateTicks();
+          if (change_detector) {
+            message << ", static skipped "
+                    << change_detector->GetSkippedFrames();
+          }
+        }
+      }
+
+      // Send the held frame once per tick, repeating it if nothing new arrived
+      if ((pfds[1].revents & POLLIN) && pacer->Tick() && held_buffer) {
+        if (!send_frame(*held_buffer)) {
+          break;
+        }
+        pacer->OnSend();
+        if (first_send) {
+          StartupTimer::Report();
+          first_send = false;
+        }
+      }
     }
 
-    // Return capture buffer
-    capture->Queue(capture_buffer);
+    while (!pacer && !g_quit) {
+      // Acquire capture buffer
+      if (!dequeue_policy.Wait(capture_fd, POLLIN)) {
+        if (!g_quit) {
+          Log(LogLevel::kError) << "Capture device stopped!";
+        }
+        break;
+      }
+      auto capture_lease = config.drain
+                               ? capture_device->LeaseNewest(&discarded_frames)
+                               : capture_device->Lease();
+      if (!capture_lease) {
+        if (!recover_capture()) {
+          break;
+        }
+        continue;
+      }
+      const V4L2DeviceBuffer& capture_buffer = *capture_lease;
+      dequeue_policy.RecordLatency(capture_buffer.timestamp_us);
+      if (frames == 0) {
+        StartupTimer::Mark("first DQBUF");
+      }
+
+      // Copy video frame to output device
+      if (!send_frame(capture_buffer)) {
+        break;
+      }
+
+      // Render
+      if (renderer) {
+        renderer->RenderFrameYUY2(config.video_width, config.video_height,
+                                  (uint8_t*)capture_buffer.data,
+                                  capture_pix_format.bytesperline);
+        if (frames == 0) {
+          StartupTimer::Mark("first render");
+        }
+      }
+      if (frames == 0) {
+        StartupTimer::Report();
+      }
 
-    ++frames;
-    if (frames % 100 == 0) {
-      std::cout << "Frames " << frames << std::endl;
+      // Hold capture buffer as the last good frame, returning the previous one
+      held_buffer = std::move(capture_lease);
+
+      ++frames;
+      if (frames % 100 == 0) {
+        LogMessage message(LogLevel::kInfo);
+        message << "Frames " << frames;
+        if (config.drain) {
+          message << ", discarded " << discarded_frames;
+        }
+        if (change_detector) {
+          message << ", static skipped " << change_detector->GetSkippedFrames();
+        }
+      }
     }
+  };
+  std::visit(stream, v4l2_get_capture_device(capture.get()),
+             v4l2_get_output_device(output.get()));
+
+  if (!pacer) {
+    dequeue_policy.Report();
+  }
+  Logger::Flush();
+  if (renderer) {
+    renderer->Report();
+  }
+  if (change_detector) {
+    change_detector->Report();
+  }
+  if (ladder) {
+    ladder->Report();
+  }
+  if (capture_checksums) {
+    capture_checksums->Report("capture");
+    output_checksums->Report("output");
+    std::cout << "Checksum mismatches " << checksum_mismatches << std::endl;
   }
 
+  Trace::Flush();
+
   // Clean up
+  pacer.reset();
   capture.reset();
   output.reset();
+  ladder.reset();
+  for (LadderOutput& rung : ladder_outputs) {
+    rung.output.reset();
+  }
   renderer.reset();
   return 0;
 }
@@ -28,131 +28,119 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include <cctype>
 #include <cstdint>
-#include <cstring>
 
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
+#include <string>
 #include <vector>
 
-#include <fcntl.h>
 #include <linux/videodev2.h>
-#include <sys/ioctl.h>
-#include <unistd.h>
 
-#include "check.h"
-
-void ListMemoryTypes(int fd) {
-  std::vector<int> memory_types = {V4L2_MEMORY_DMABUF, V4L2_MEMORY_MMAP,
-                                   V4L2_MEMORY_USERPTR};
-  std::vector<const char*> memory_types_str = {
-      "V4L2_MEMORY_DMABUF", "V4L2_MEMORY_MMAP", "V4L2_MEMORY_USERPTR"};
-
-  for (size_t i = 0; i < memory_types.size(); i++) {
-    v4l2_requestbuffers reqbuf = {};
-    reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    reqbuf.memory = memory_types[i];
-    reqbuf.count = 1;
-
-    int ret = ioctl(fd, VIDIOC_REQBUFS, &reqbuf);
-    std::cout << "  " << memory_types_str[i] << ": " << (ret == 0) << std::endl;
-  }
+#include "v4l2_device_cache.h"
+#include "v4l2_device_info.h"
+
+void ListMemoryTypes(const V4L2DeviceInfo& info) {
+  std::cout << "  V4L2_MEMORY_DMABUF: "
+            << bool(info.memory_caps & V4L2_BUF_CAP_SUPPORTS_DMABUF)
+            << std::endl;
+  std::cout << "  V4L2_MEMORY_MMAP: "
+            << bool(info.memory_caps & V4L2_BUF_CAP_SUPPORTS_MMAP)
+            << std::endl;
+  std::cout << "  V4L2_MEMORY_USERPTR: "
+            << bool(info.memory_caps & V4L2_BUF_CAP_SUPPORTS_USERPTR)
+            << std::endl;
 }
 
-void ListFrameRate(int fd,
-                   uint32_t pixelformat,
-                   uint32_t width,
-                   uint32_t height) {
-  v4l2_frmivalenum vfie = {};
-  vfie.pixel_format = pixelformat;
-  vfie.width = width;
-  vfie.height = height;
-
-  while (!ioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &vfie)) {
-    CHECK(vfie.type == V4L2_FRMIVAL_TYPE_DISCRETE);
+void ListFrameRate(const V4L2FrameSizeInfo& size) {
+  for (const v4l2_fract& interval : size.intervals) {
     std::cout << "         frame rate: "
-              << float(vfie.discrete.denominator) / vfie.discrete.numerator
-              << std::endl;
-    vfie.index += 1;
+              << float(interval.denominator) / interval.numerator << std::endl;
   }
 }
 
-void ListFrameSize(int fd, uint32_t pixelformat) {
-  v4l2_frmsizeenum vfse = {};
-  vfse.pixel_format = pixelformat;
-
-  while (!ioctl(fd, VIDIOC_ENUM_FRAMESIZES, &vfse)) {
-    switch (vfse.type) {
-      case V4L2_FRMSIZE_TYPE_DISCRETE:
-        std::cout << "      " << vfse.discrete.width << "x"
-                  << vfse.discrete.height << std::endl;
-
-        ListFrameRate(fd, pixelformat, vfse.discrete.width,
-                      vfse.discrete.height);
-        break;
-      case V4L2_FRMSIZE_TYPE_CONTINUOUS:
-      case V4L2_FRMSIZE_TYPE_STEPWISE:
-        std::cout << "      " << "Width Range " << vfse.stepwise.min_width
-                  << " -> " << vfse.stepwise.max_width << " step "
-                  << vfse.stepwise.step_width << ", Height Range "
-                  << vfse.stepwise.min_height << " -> "
-                  << vfse.stepwise.max_height << " step "
-                  << vfse.stepwise.step_height << std::endl;
-    }
-    vfse.index++;
+void ListFrameSize(const V4L2FormatInfo& format) {
+  for (const V4L2FrameSizeInfo& size : format.sizes) {
+    std::cout << "      " << size.width << "x" << size.height << std::endl;
+    ListFrameRate(size);
   }
-}
 
-void ListV4L2Device(int fd) {
-  v4l2_capability cap = {};
-  if (ioctl(fd, VIDIOC_QUERYCAP, &cap) < 0) {
-    std::cout << "ioctl(VIDIOC_QUERYCAP): fail\n";
-    return;
+  if (format.has_range) {
+    const v4l2_frmsize_stepwise& range = format.range;
+    std::cout << "      " << "Width Range " << range.min_width << " -> "
+              << range.max_width << " step " << range.step_width
+              << ", Height Range " << range.min_height << " -> "
+              << range.max_height << " step " << range.step_height
+              << std::endl;
   }
-  std::cout << "  " << "Description: " << cap.card << "," << cap.driver << ","
-            << cap.bus_info << std::endl;
+}
+
+void ListV4L2Device(const V4L2DeviceInfo& info) {
+  std::cout << "  " << "Description: " << info.card << "," << info.driver
+            << "," << info.bus_info << std::endl;
 
-  const bool kVideoCapture = (cap.capabilities & V4L2_CAP_VIDEO_CAPTURE);
-  const bool kVideoOutput = (cap.capabilities & V4L2_CAP_VIDEO_OUTPUT);
-  const bool kReadWrite = (cap.capabilities & V4L2_CAP_READWRITE);
-  const bool kStreaming = (cap.capabilities & V4L2_CAP_STREAMING);
+  const bool kVideoCapture = (info.capabilities & V4L2_CAP_VIDEO_CAPTURE);
+  const bool kVideoOutput = (info.capabilities & V4L2_CAP_VIDEO_OUTPUT);
+  const bool kReadWrite = (info.capabilities & V4L2_CAP_READWRITE);
+  const bool kStreaming = (info.capabilities & V4L2_CAP_STREAMING);
   std::cout << "  " << "VIDEO_CAPTURE: " << kVideoCapture << std::endl;
   std::cout << "  " << "VIDEO_OUTPUT: " << kVideoOutput << std::endl;
   std::cout << "  " << "READWRITE: " << kReadWrite << std::endl;
   std::cout << "  " << "STREAMING: " << kStreaming << std::endl;
 
   if (kVideoCapture) {
-    v4l2_fmtdesc vfd = {};
-    vfd.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-
     std::cout << "  Supported Formats:\n";
-    while (!ioctl(fd, VIDIOC_ENUM_FMT, &vfd)) {
-      const bool kCompressed = (vfd.flags & V4L2_FMT_FLAG_COMPRESSED);
+    for (const V4L2FormatInfo& format : info.formats) {
+      const bool kCompressed = (format.flags & V4L2_FMT_FLAG_COMPRESSED);
       std::cout << "    " << (kCompressed ? "Compressed" : "Raw") << ", "
-                << vfd.description << std::endl;
-
-      ListFrameSize(fd, vfd.pixelformat);
+                << format.description << std::endl;
 
-      vfd.index++;
+      ListFrameSize(format);
     }
   }
 }
 
-void ListAll() {
-  std::string basename = "/dev/video";
+// Returns /dev/videoN nodes ordered by N
+std::vector<std::string> FindVideoDevices() {
+  const std::string basename = "video";
 
-  for (int i = 0; i < 10; i++) {
-    std::string dev_name = basename + std::to_string(i);
-    int fd = open(dev_name.c_str(), O_RDWR);
-    if (fd < 0) {
+  std::vector<int> numbers;
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator("/dev", ec)) {
+    std::string name = entry.path().filename().string();
+    if (name.rfind(basename, 0) != 0 || name.size() == basename.size() ||
+        !std::all_of(name.begin() + basename.size(), name.end(), ::isdigit)) {
       continue;
     }
+    numbers.push_back(std::stoi(name.substr(basename.size())));
+  }
+  std::sort(numbers.begin(), numbers.end());
+
+  std::vector<std::string> paths;
+  for (int number : numbers) {
+    paths.push_back("/dev/" + basename + std::to_string(number));
+  }
+  return paths;
+}
 
+void ListAll() {
+  // Enumerate all devices in parallel, then refresh the device cache used by
+  // the other apps
+  std::vector<V4L2DeviceInfo> devices = v4l2_query_devices(FindVideoDevices());
+
+  V4L2DeviceCache cache;
+  cache.Load();
+  for (const V4L2DeviceInfo& info : devices) {
     std::cout << "======\n";
-    std::cout << "Open device: " << dev_name.c_str() << std::endl;
-    ListV4L2Device(fd);
-    ListMemoryTypes(fd);
-    close(fd);
+    std::cout << "Open device: " << info.path << std::endl;
+    ListV4L2Device(info);
+    ListMemoryTypes(info);
+
+    cache.Update(info);
   }
+  cache.Save();
 }
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,305 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2025, Jianhui Dai
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <variant>
+
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cxxopts.hpp>
+
+#include "frame_pacer.h"
+#include "logger.h"
+#include "pattern_generator.h"
+#include "trace.h"
+#include "v4l2_stream_device.h"
+#include "v4l2_utils.h"
+
+struct Config {
+  std::string output_device;
+  uint32_t video_width;
+  uint32_t video_height;
+  std::string format;
+  uint32_t fps;
+  uint64_t frames;
+
+  bool dmabuf;
+  std::string memory;
+  V4L2MemoryType memory_type;
+
+  std::string trace;
+  std::string log_level;
+};
+
+bool g_quit = false;
+void sighandler(int) {
+  if (!g_quit) {
+    g_quit = true;
+    signal(SIGINT, SIG_DFL);
+    std::cout << "Quit\n";
+  }
+}
+
+void ParseCommandLine(int argc, char** argv, Config& config) {
+  try {
+    std::string program_name = argv[0];
+    cxxopts::Options options(program_name, "");
+
+    options.add_option("", {"h, help", "Print help"});
+
+    options.add_option(
+        "", {"o, output", "Specify output device",
+             cxxopts::value<std::string>()->default_value("/dev/video2")});
+    options.add_option("", {"width", "Specify video width",
+                            cxxopts::value<uint32_t>()->default_value("640")});
+    options.add_option("", {"height", "Specify video height",
+                            cxxopts::value<uint32_t>()->default_value("360")});
+    options.add_option(
+        "", {"format", "Pixel format: yuyv, nv12 or i420",
+             cxxopts::value<std::string>()->default_value("yuyv")});
+    options.add_option(
+        "", {"fps", "Output frame rate, 0 for as fast as possible",
+             cxxopts::value<uint32_t>()->default_value("30")});
+    options.add_option(
+        "", {"frames", "Stop after this many frames, 0 for unlimited",
+             cxxopts::value<uint64_t>()->default_value("0")});
+    options.add_option(
+        "",
+        {"dmabuf", "Use DMABUF for output device enqueuing (default: false)",
+         cxxopts::value<bool>()->default_value("false")->implicit_value(
+             "true")});
+    options.add_option(
+        "", {"memory", "Output buffer memory: mmap, expbuf, dmabuf or userptr",
+             cxxopts::value<std::string>()->default_value("mmap")});
+    options.add_option(
+        "", {"trace", "Write a Chrome trace here, toggled with SIGUSR1",
+             cxxopts::value<std::string>()->default_value("")});
+    options.add_option(
+        "", {"log_level", "Log level: debug, info, warning or error",
+             cxxopts::value<std::string>()->default_value("info")});
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help")) {
+      std::cout << options.help() << std::endl;
+      exit(0);
+    }
+
+    config.output_device = result["output"].as<std::string>();
+    config.video_width = result["width"].as<uint32_t>();
+    config.video_height = result["height"].as<uint32_t>();
+    config.format = result["format"].as<std::string>();
+    config.fps = result["fps"].as<uint32_t>();
+    config.frames = result["frames"].as<uint64_t>();
+    config.dmabuf = result["dmabuf"].as<bool>();
+    config.memory = result["memory"].as<std::string>();
+    config.trace = result["trace"].as<std::string>();
+    config.log_level = result["log_level"].as<std::string>();
+
+    // --dmabuf predates --memory
+    if (config.dmabuf) {
+      config.memory = "dmabuf";
+    }
+    if (!v4l2_parse_memory_type(config.memory, &config.memory_type)) {
+      std::cout << "Invalid memory: " << config.memory << std::endl;
+      exit(-1);
+    }
+  } catch (const cxxopts::exceptions::exception& e) {
+    std::cout << "error parsing options: " << e.what() << std::endl;
+    exit(-1);
+  }
+}
+
+uint64_t GetMonotonicUs() {
+  timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+int main(int argc, char* argv[]) {
+  constexpr uint32_t kBufferCount = 4;
+
+  Config config;
+  ParseCommandLine(argc, argv, config);
+
+  std::cout << "======" << std::endl;
+  std::cout << "output_device: " << config.output_device << std::endl;
+  std::cout << "video_width: " << config.video_width << std::endl;
+  std::cout << "video_height: " << config.video_height << std::endl;
+  std::cout << "format: " << config.format << std::endl;
+  std::cout << "fps: " << config.fps << std::endl;
+  std::cout << "frames: " << config.frames << std::endl;
+  std::cout << "dmabuf: " << config.dmabuf << std::endl;
+  std::cout << "memory: " << config.memory << std::endl;
+  std::cout << "trace: " << config.trace << std::endl;
+  std::cout << "log_level: " << config.log_level << std::endl;
+
+  if (!config.trace.empty() && !Trace::Initialize(config.trace)) {
+    return -1;
+  }
+  Trace::SetThreadName("output");
+
+  LogLevel log_level;
+  if (!Logger::ParseLevel(config.log_level, &log_level)) {
+    std::cout << "Invalid log level: " << config.log_level << std::endl;
+    return -1;
+  }
+  Logger::Initialize(log_level);
+
+  uint32_t pixelformat;
+  if (config.format == "yuyv") {
+    pixelformat = V4L2_PIX_FMT_YUYV;
+  } else if (config.format == "nv12") {
+    pixelformat = V4L2_PIX_FMT_NV12;
+  } else if (config.format == "i420") {
+    pixelformat = V4L2_PIX_FMT_YUV420;
+  } else {
+    std::cout << "Invalid format: " << config.format << std::endl;
+    return -1;
+  }
+
+  // Open and initialize output device
+  std::cout << "======" << std::endl;
+  int output_fd = open(config.output_device.c_str(), O_RDWR);
+  if (output_fd < 0) {
+    std::cout << "Invalid device: " << config.output_device << std::endl;
+    return -1;
+  }
+
+  v4l2_pix_format pix_format = {};
+  pix_format.pixelformat = pixelformat;
+  pix_format.width = config.video_width;
+  pix_format.height = config.video_height;
+  pix_format.field = V4L2_FIELD_NONE;
+  pix_format.bytesperline =
+      PatternGenerator::GetBytesPerLine(pixelformat, config.video_width);
+  pix_format.sizeimage = PatternGenerator::GetFrameSize(
+      pixelformat, pix_format.bytesperline, config.video_height);
+  if (!v4l2_set_pix_format(output_fd, V4L2_BUF_TYPE_VIDEO_OUTPUT,
+                           &pix_format)) {
+    return -1;
+  }
+
+  std::unique_ptr<V4L2Device> output = v4l2_create_output_device(
+      config.memory_type, output_fd, config.video_width, config.video_height);
+  output->Initialize(kBufferCount);
+  output->Start();
+
+  PatternGenerator generator(pixelformat, config.video_width,
+                             config.video_height, pix_format.bytesperline);
+
+  std::unique_ptr<FramePacer> pacer;
+  if (config.fps) {
+    pacer = std::make_unique<FramePacer>(v4l2_fract{1, config.fps});
+    pacer->Start();
+  }
+
+  // Main loop
+  using Clock = std::chrono::steady_clock;
+  uint64_t frames = 0;
+  uint64_t report_frames = 0;
+  Clock::duration fill_time = {};
+  Clock::time_point report_start = Clock::now();
+  signal(SIGINT, sighandler);
+
+  // Stream with the device as its own type, without virtual calls
+  auto stream = [&](auto* output_device) {
+    while (!g_quit && (config.frames == 0 || frames < config.frames)) {
+      // Wait for the next tick, or run flat out without a frame rate
+      if (pacer) {
+        if (!v4l2_poll(pacer->GetFd(), POLLIN)) {
+          break;
+        }
+        if (!pacer->Tick()) {
+          continue;
+        }
+      }
+
+      if (!v4l2_poll(output_fd, POLLOUT)) {
+        Log(LogLevel::kError) << "Output device stopped!";
+        break;
+      }
+      auto output_lease = output_device->Lease();
+      if (!output_lease) {
+        Log(LogLevel::kError) << "Output device lost";
+        break;
+      }
+
+      // Generate straight into the output buffer
+      Clock::time_point start = Clock::now();
+      {
+        ScopedTrace trace("fill", frames);
+        generator.Fill((uint8_t*)output_lease->data, output_lease->len, frames,
+                       GetMonotonicUs());
+      }
+      fill_time += Clock::now() - start;
+
+      output_lease.Reset();
+
+      ++frames;
+      ++report_frames;
+      const Clock::duration elapsed = Clock::now() - report_start;
+      if (elapsed >= std::chrono::seconds(1)) {
+        const double seconds = std::chrono::duration<double>(elapsed).count();
+        const double fill_us =
+            std::chrono::duration<double, std::micro>(fill_time).count();
+        LogMessage message(LogLevel::kInfo);
+        message << "Frames " << frames << ", "
+                << uint32_t(report_frames / seconds)
+                << " fps, fill " << uint32_t(fill_us / report_frames)
+                << " us/frame";
+        if (pacer) {
+          message << ", late ticks " << pacer->GetLateTicks();
+        }
+
+        report_frames = 0;
+        fill_time = {};
+        report_start = Clock::now();
+      }
+    }
+  };
+  std::visit(stream, v4l2_get_output_device(output.get()));
+
+  Trace::Flush();
+
+  // Clean up
+  pacer.reset();
+  output.reset();
+  close(output_fd);
+  Logger::Flush();
+  return 0;
+}
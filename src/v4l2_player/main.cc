@@ -28,8 +28,14 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <iostream>
 #include <memory>
+#include <sstream>
+#include <thread>
+#include <variant>
 #include <vector>
 
 #include <fcntl.h>
@@ -37,15 +43,26 @@
 #include <poll.h>
 #include <signal.h>
 #include <sys/ioctl.h>
+#include <time.h>
 
 #include <SDL2/SDL.h>
 
 #include <cxxopts.hpp>
 
-#include "capture_device_mmap.h"
 #include "check.h"
-#include "sdl2_video_renderer.h"
+#include "checksum_log.h"
+#include "dequeue_policy.h"
+#include "logger.h"
+#include "m2m_encoder.h"
+#include "rt_utils.h"
+#include "sdl2_mosaic_renderer.h"
+#include "startup_timer.h"
+#include "trace.h"
+#include "v4l2_device_cache.h"
+#include "v4l2_device_monitor.h"
+#include "v4l2_stream_device.h"
 #include "v4l2_utils.h"
+#include "video_renderer.h"
 
 struct Config {
   std::string capture_device;
@@ -54,9 +71,79 @@ struct Config {
   uint32_t video_height;
 
   bool dmabuf;
+  std::string memory;
+  V4L2MemoryType memory_type;
+
+  std::string renderer;
+  std::string checksum;
+  std::string encoder;
+  std::string record;
+  std::string trace;
+  std::string log_level;
+
+  std::string dequeue;
+  bool drain;
+
+  std::string sched;
+  std::string cpus;
+  bool mlock;
 };
 
-bool g_quit = false;
+// Capture-to-display latency, from the capture timestamp of a frame to the
+// return of its render. A producer such as v4l2_clone_device copies the
+// timestamp of the camera into its output buffers, so this holds across
+// processes.
+struct DisplayLatency {
+  // Percentiles are resolved to 100 us, up to 100 ms
+  static constexpr int64_t kBucketUs = 100;
+  static constexpr size_t kBuckets = 1000;
+
+  uint64_t samples = 0;
+  int64_t total_us = 0;
+  int64_t max_us = 0;
+  std::array<uint32_t, kBuckets> histogram = {};
+
+  void Add(uint64_t timestamp_us) {
+    timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    const int64_t now_us = int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    if (timestamp_us == 0 || int64_t(timestamp_us) > now_us) {
+      return;
+    }
+
+    const int64_t latency_us = now_us - int64_t(timestamp_us);
+    samples++;
+    total_us += latency_us;
+    max_us = std::max(max_us, latency_us);
+    histogram[std::min<size_t>(latency_us / kBucketUs, kBuckets - 1)]++;
+  }
+
+  // Upper bound of the bucket holding the `percent` percentile
+  int64_t Percentile(uint32_t percent) const {
+    const uint64_t rank = (samples * percent + 99) / 100;
+    uint64_t count = 0;
+    for (size_t i = 0; i < kBuckets - 1; i++) {
+      count += histogram[i];
+      if (count >= rank) {
+        return std::min(int64_t(i + 1) * kBucketUs, max_us);
+      }
+    }
+    return max_us;
+  }
+
+  void Print(LogMessage& message) const {
+    if (samples) {
+      message << "latency avg " << total_us / int64_t(samples) << " us p50 "
+              << Percentile(50) << " us p95 " << Percentile(95)
+              << " us p99 " << Percentile(99) << " us max " << max_us
+              << " us";
+    } else {
+      message << "latency unknown";
+    }
+  }
+};
+
+std::atomic<bool> g_quit = false;
 void sighandler(int) {
   if (!g_quit) {
     g_quit = true;
@@ -73,7 +160,7 @@ void ParseCommandLine(int argc, char** argv, Config& config) {
     options.add_option("", {"h, help", "Print help"});
 
     options.add_option(
-        "", {"i, input", "Specify capture device",
+        "", {"i, input", "Capture device, or a comma-separated list to tile",
              cxxopts::value<std::string>()->default_value("/dev/video0")});
     options.add_option("", {"width", "Specify capture video width",
                             cxxopts::value<uint32_t>()->default_value("640")});
@@ -83,6 +170,48 @@ void ParseCommandLine(int argc, char** argv, Config& config) {
         "", {"dmabuf", "V4L2 capture device exports DMABUF (default: false)",
              cxxopts::value<bool>()->default_value("false")->implicit_value(
                  "true")});
+    options.add_option(
+        "", {"memory", "Capture buffer memory: mmap, expbuf, dmabuf or userptr",
+             cxxopts::value<std::string>()->default_value("mmap")});
+
+    options.add_option(
+        "", {"checksum", "Write frame checksums to a log file",
+             cxxopts::value<std::string>()->default_value("")});
+    options.add_option(
+        "", {"encoder", "Encode frames to FWHT with this mem2mem device",
+             cxxopts::value<std::string>()->default_value("")});
+    options.add_option(
+        "", {"record", "Write the encoded frames to this file",
+             cxxopts::value<std::string>()->default_value("")});
+    options.add_option(
+        "", {"trace", "Write a Chrome trace here, toggled with SIGUSR1",
+             cxxopts::value<std::string>()->default_value("")});
+    options.add_option(
+        "", {"log_level", "Log level: debug, info, warning or error",
+             cxxopts::value<std::string>()->default_value("info")});
+    options.add_option(
+        "", {"renderer", "Preview backend: sdl, offscreen or null",
+             cxxopts::value<std::string>()->default_value("sdl")});
+
+    options.add_option(
+        "", {"dequeue", "Capture wait mode: block, spin or busy",
+             cxxopts::value<std::string>()->default_value("block")});
+
+    options.add_option(
+        "", {"drain",
+             "Skip to the newest ready frame when behind (default: false)",
+             cxxopts::value<bool>()->default_value("false")->implicit_value(
+                 "true")});
+    options.add_option(
+        "", {"sched", "Thread scheduling: other, fifo:<prio> or deadline",
+             cxxopts::value<std::string>()->default_value("other")});
+    options.add_option(
+        "", {"cpus", "Pin the streaming thread to CPUs, e.g. 2,3 or 2-5",
+             cxxopts::value<std::string>()->default_value("")});
+    options.add_option(
+        "", {"mlock", "Lock memory and prefault buffers (default: false)",
+             cxxopts::value<bool>()->default_value("false")->implicit_value(
+                 "true")});
 
     auto result = options.parse(argc, argv);
 
@@ -95,16 +224,125 @@ void ParseCommandLine(int argc, char** argv, Config& config) {
     config.video_width = result["width"].as<uint32_t>();
     config.video_height = result["height"].as<uint32_t>();
     config.dmabuf = result["dmabuf"].as<bool>();
+    config.memory = result["memory"].as<std::string>();
+    config.renderer = result["renderer"].as<std::string>();
+    config.checksum = result["checksum"].as<std::string>();
+    config.encoder = result["encoder"].as<std::string>();
+    config.record = result["record"].as<std::string>();
+    config.trace = result["trace"].as<std::string>();
+    config.log_level = result["log_level"].as<std::string>();
+    config.dequeue = result["dequeue"].as<std::string>();
+    config.drain = result["drain"].as<bool>();
+    config.sched = result["sched"].as<std::string>();
+    config.cpus = result["cpus"].as<std::string>();
+    config.mlock = result["mlock"].as<bool>();
+
+    // --dmabuf predates --memory and exports the mmap buffers
+    if (config.dmabuf) {
+      config.memory = "expbuf";
+    }
+    if (!v4l2_parse_memory_type(config.memory, &config.memory_type)) {
+      std::cout << "Invalid memory: " << config.memory << std::endl;
+      exit(-1);
+    }
   } catch (const cxxopts::exceptions::exception& e) {
     std::cout << "error parsing options: " << e.what() << std::endl;
     exit(-1);
   }
 }
 
-int main(int argc, char* argv[]) {
-  constexpr uint32_t kPixFormat = V4L2_PIX_FMT_YUYV;
-  constexpr uint32_t kBufferCount = 10;
+constexpr uint32_t kPixFormat = V4L2_PIX_FMT_YUYV;
+constexpr uint32_t kBufferCount = 10;
+
+// Captures from every device on its own thread and tiles them into one
+// mosaic window, presented from this thread once per display refresh
+int RunMosaic(const Config& config, const std::vector<std::string>& devices) {
+  SDL2MosaicRenderer mosaic("v4l2_player mosaic", devices.size());
+
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < devices.size(); i++) {
+    threads.emplace_back([&, i]() {
+      const std::string& device = devices[i];
+      Trace::SetThreadName("tile " + std::to_string(i));
+      int capture_fd = open(device.c_str(), O_RDWR);
+      if (capture_fd < 0) {
+        std::cout << "Invalid device: " << device << std::endl;
+        return;
+      }
+
+      uint32_t width = config.video_width;
+      uint32_t height = config.video_height;
+      v4l2_pix_format pix_format = {};
+      if (!v4l2_select_capture_mode(capture_fd, kPixFormat, &width,
+                                    &height)) {
+        close(capture_fd);
+        return;
+      }
+      pix_format.pixelformat = kPixFormat;
+      pix_format.width = width;
+      pix_format.height = height;
+      if (!v4l2_set_pix_format(capture_fd, V4L2_BUF_TYPE_VIDEO_CAPTURE,
+                               &pix_format)) {
+        close(capture_fd);
+        return;
+      }
+
+      std::unique_ptr<V4L2Device> capture =
+          v4l2_create_capture_device(config.memory_type, capture_fd, width,
+                                     height);
+      capture->Initialize(kBufferCount);
+      capture->Start();
+      std::cout << "Tile " << i << ": " << device << " " << width << "x"
+                << height << std::endl;
 
+      auto stream = [&](auto* capture_device) {
+        while (!g_quit) {
+          // Wake up periodically to notice quit
+          pollfd fds = {capture_fd, POLLIN, 0};
+          if (poll(&fds, 1, 100) <= 0) {
+            continue;
+          }
+          auto capture_lease = capture_device->Lease();
+          if (!capture_lease) {
+            Log(LogLevel::kError) << "Tile " << i << ": " << device << " lost";
+            break;
+          }
+          mosaic.UpdateTileYUY2(i, width, height,
+                                (uint8_t*)capture_lease->data,
+                                pix_format.bytesperline);
+        }
+      };
+      std::visit(stream, v4l2_get_capture_device(capture.get()));
+
+      capture.reset();
+      close(capture_fd);
+    });
+  }
+
+  Trace::SetThreadName("present");
+  signal(SIGINT, sighandler);
+  uint64_t presents = 0;
+  uint64_t updates = 0;
+  while (!g_quit) {
+    if (mosaic.Present() && mosaic.GetPresentCount() % 100 == 0) {
+      Log(LogLevel::kInfo) << "Presents "
+                           << mosaic.GetPresentCount() - presents
+                           << ", tile updates "
+                           << mosaic.GetTileUpdateCount() - updates;
+      presents = mosaic.GetPresentCount();
+      updates = mosaic.GetTileUpdateCount();
+    }
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  Logger::Flush();
+  Trace::Flush();
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
   Config config;
   ParseCommandLine(argc, argv, config);
 
@@ -113,15 +351,81 @@ int main(int argc, char* argv[]) {
   std::cout << "video_width: " << config.video_width << std::endl;
   std::cout << "video_height: " << config.video_height << std::endl;
   std::cout << "dmabuf: " << config.dmabuf << std::endl;
+  std::cout << "memory: " << config.memory << std::endl;
+  std::cout << "renderer: " << config.renderer << std::endl;
+  std::cout << "checksum: " << config.checksum << std::endl;
+  std::cout << "encoder: " << config.encoder << std::endl;
+  std::cout << "record: " << config.record << std::endl;
+  std::cout << "trace: " << config.trace << std::endl;
+  std::cout << "log_level: " << config.log_level << std::endl;
+  std::cout << "dequeue: " << config.dequeue << std::endl;
+  std::cout << "drain: " << config.drain << std::endl;
+  std::cout << "sched: " << config.sched << std::endl;
+  std::cout << "cpus: " << config.cpus << std::endl;
+  std::cout << "mlock: " << config.mlock << std::endl;
+
+  if (!config.trace.empty() && !Trace::Initialize(config.trace)) {
+    return -1;
+  }
+
+  LogLevel log_level;
+  if (!Logger::ParseLevel(config.log_level, &log_level)) {
+    std::cout << "Invalid log level: " << config.log_level << std::endl;
+    return -1;
+  }
+  Logger::Initialize(log_level);
+
+  VideoRenderer::Backend renderer_backend;
+  if (!VideoRenderer::ParseBackend(config.renderer, &renderer_backend)) {
+    std::cout << "Invalid renderer: " << config.renderer << std::endl;
+    return -1;
+  }
+
+  DequeuePolicy::Mode dequeue_mode;
+  if (!DequeuePolicy::ParseMode(config.dequeue, &dequeue_mode)) {
+    std::cout << "Invalid dequeue mode: " << config.dequeue << std::endl;
+    return -1;
+  }
+
+  RtProfile rt_profile;
+  if (!rt_parse_profile(config.sched, config.cpus, config.mlock,
+                        &rt_profile) ||
+      !rt_lock_memory(rt_profile)) {
+    return -1;
+  }
+
+  std::vector<std::string> devices;
+  {
+    std::stringstream stream(config.capture_device);
+    std::string device;
+    while (std::getline(stream, device, ',')) {
+      if (!device.empty()) {
+        devices.push_back(device);
+      }
+    }
+  }
+  if (devices.size() > 1) {
+    return RunMosaic(config, devices);
+  }
 
   // Open and initialize capture device
   std::cout << "======" << std::endl;
-  int capture_fd = open(config.capture_device.c_str(), O_RDWR);
+  int capture_fd;
+  {
+    ScopedStartupTimer timer("capture open");
+    capture_fd = open(config.capture_device.c_str(), O_RDWR);
+  }
   if (capture_fd < 0) {
     std::cout << "Invalid device: " << config.capture_device << std::endl;
     return -1;
   }
 
+  // Choose the capture mode from the cached device capabilities
+  if (!v4l2_select_capture_mode(capture_fd, kPixFormat, &config.video_width,
+                                &config.video_height)) {
+    return -1;
+  }
+
   v4l2_pix_format capture_pix_format = {};
   capture_pix_format.pixelformat = kPixFormat;
   capture_pix_format.width = config.video_width;
@@ -131,43 +435,200 @@ int main(int argc, char* argv[]) {
                            &capture_pix_format)) {
     return -1;
   }
+  std::cout << "Capture format: " << capture_pix_format.width << "x"
+            << capture_pix_format.height << std::endl;
+
+  V4L2DeviceInfo capture_info;
+  if (!v4l2_query_capability(capture_fd, &capture_info)) {
+    return -1;
+  }
 
   // Create capture v4l2 device
-  std::unique_ptr<V4L2Device> capture = std::make_unique<CaptureDeviceMmap>(
-      capture_fd, config.video_width, config.video_height, config.dmabuf);
+  std::unique_ptr<V4L2Device> capture =
+      v4l2_create_capture_device(config.memory_type, capture_fd,
+                                 config.video_width, config.video_height);
   capture->Initialize(kBufferCount);
+  if (rt_profile.lock_memory) {
+    capture->Prefault();
+  }
   capture->Start();
 
   // Create renderer with default windows 640x360
-  std::unique_ptr<SDL2VideoRenderer> renderer =
-      std::make_unique<SDL2VideoRenderer>(
-          v4l2_get_device_name(capture_fd).c_str());
+  std::unique_ptr<VideoRenderer> renderer;
+  {
+    ScopedStartupTimer timer("renderer creation");
+    renderer = VideoRenderer::Create(renderer_backend,
+                                     capture_info.card.c_str());
+  }
+  if (rt_profile.lock_memory) {
+    renderer->Reserve(config.video_width, config.video_height);
+  }
+
+  // Encode alongside playback on the encoder's own thread, importing the
+  // capture dmabufs when the capture memory has them
+  std::unique_ptr<M2MEncoder> encoder;
+  if (!config.encoder.empty()) {
+    const int encoder_fd = open(config.encoder.c_str(), O_RDWR);
+    if (encoder_fd < 0) {
+      std::cout << "Invalid device: " << config.encoder << std::endl;
+      return -1;
+    }
+    const bool import = config.memory_type == V4L2MemoryType::kExpbuf ||
+                        config.memory_type == V4L2MemoryType::kDmabuf;
+    encoder = std::make_unique<M2MEncoder>(encoder_fd, V4L2_PIX_FMT_FWHT);
+    if (!encoder->Initialize(capture_pix_format, kBufferCount, import,
+                             config.record)) {
+      return -1;
+    }
+  }
+
+  // Wait for a lost capture device to come back and renegotiate the same
+  // format
+  auto recover_capture = [&]() {
+    Log(LogLevel::kWarning) << "Capture device lost, waiting for "
+                            << capture_info.bus_info;
+    if (encoder) {
+      encoder->Drain();
+    }
+    capture->Release();
+    close(capture_fd);
+    capture_fd = -1;
+
+    V4L2DeviceMonitor monitor;
+    while (!g_quit && capture_fd < 0) {
+      capture_fd =
+          monitor.WaitForDevice(config.capture_device, capture_info.bus_info,
+                                V4L2_CAP_VIDEO_CAPTURE, 100);
+    }
+    if (capture_fd < 0) {
+      return false;
+    }
+
+    v4l2_pix_format pix_format = capture_pix_format;
+    if (!v4l2_set_pix_format(capture_fd, V4L2_BUF_TYPE_VIDEO_CAPTURE,
+                             &pix_format)) {
+      return false;
+    }
+    capture->Reopen(capture_fd);
+
+    Log(LogLevel::kInfo) << "Capture device recovered";
+    return true;
+  };
+
+  // Checksums of the frames received, keyed by sequence, to compare with
+  // the log of the sender
+  std::unique_ptr<ChecksumLog> checksums;
+  if (!config.checksum.empty()) {
+    checksums = std::make_unique<ChecksumLog>(config.checksum);
+    if (!checksums->IsOpen()) {
+      return -1;
+    }
+  }
+
+  DequeuePolicy dequeue_policy(dequeue_mode, &g_quit);
+  v4l2_fract timeperframe = {};
+  if (v4l2_get_frame_rate(capture_fd, &timeperframe)) {
+    dequeue_policy.SetFrameInterval(timeperframe);
+  }
+
+  // Capture and render run on this thread
+  if (!rt_apply_thread(rt_profile, "capture", timeperframe)) {
+    return -1;
+  }
+  Trace::SetThreadName("capture");
 
   // Main loop
   uint32_t frames = 0;
+  uint64_t discarded_frames = 0;
+  DisplayLatency latency;
+  DisplayLatency window_latency;
   signal(SIGINT, sighandler);
-  while (!g_quit) {
-    // Acquire buffer
-    if (!v4l2_poll(capture_fd, POLLIN)) {
-      std::cout << "Capture device stopped!\n";
-      break;
-    }
-    V4L2DeviceBuffer capture_buffer = capture->Dequeue();
 
-    // Render
-    renderer->RenderFrameYUY2(config.video_width, config.video_height,
-                              (uint8_t*)capture_buffer.data,
-                              capture_pix_format.bytesperline);
-    // Return buffer
-    capture->Queue(capture_buffer);
+  // Stream with the device as its own type, without virtual calls
+  auto stream = [&](auto* capture_device) {
+    while (!g_quit) {
+      // Acquire buffer
+      if (!dequeue_policy.Wait(capture_fd, POLLIN)) {
+        if (!g_quit) {
+          Log(LogLevel::kError) << "Capture device stopped!";
+        }
+        break;
+      }
+      auto capture_lease = config.drain
+                               ? capture_device->LeaseNewest(&discarded_frames)
+                               : capture_device->Lease();
+      if (!capture_lease) {
+        if (!recover_capture()) {
+          break;
+        }
+        continue;
+      }
+      const V4L2DeviceBuffer& capture_buffer = *capture_lease;
+      dequeue_policy.RecordLatency(capture_buffer.timestamp_us);
+      if (frames == 0) {
+        StartupTimer::Mark("first DQBUF");
+      }
 
-    ++frames;
-    if (frames % 100 == 0) {
-      std::cout << "Frames " << frames << std::endl;
+      if (checksums) {
+        checksums->Add(capture_buffer.sequence,
+                       (const uint8_t*)capture_buffer.data,
+                       capture_pix_format.bytesperline, config.video_width * 2,
+                       config.video_height);
+      }
+
+      // Render
+      renderer->RenderFrameYUY2(config.video_width, config.video_height,
+                                (uint8_t*)capture_buffer.data,
+                                capture_pix_format.bytesperline);
+      latency.Add(capture_buffer.timestamp_us);
+      window_latency.Add(capture_buffer.timestamp_us);
+      if (frames == 0) {
+        StartupTimer::Mark("first render");
+        StartupTimer::Report();
+      }
+      // Return buffer, or hand it to the encoder which returns it once read
+      if (encoder) {
+        encoder->Encode(std::move(capture_lease));
+      }
+      capture_lease.Reset();
+
+      ++frames;
+      if (frames % 100 == 0) {
+        LogMessage message(LogLevel::kInfo);
+        message << "Frames " << frames;
+        if (config.drain) {
+          message << ", discarded " << discarded_frames;
+        }
+        message << ", ";
+        window_latency.Print(message);
+        window_latency = {};
+      }
     }
+  };
+  std::visit(stream, v4l2_get_capture_device(capture.get()));
+
+  {
+    LogMessage message(LogLevel::kInfo);
+    message << "Capture to display " << frames << " frames, ";
+    latency.Print(message);
+  }
+  if (encoder) {
+    encoder->Stop();
   }
+  dequeue_policy.Report();
+  Logger::Flush();
+  renderer->Report();
+  if (checksums) {
+    checksums->Report("capture");
+  }
+  if (encoder) {
+    encoder->Report();
+  }
+
+  Trace::Flush();
 
   // Clean up
+  encoder.reset();
   capture.reset();
   renderer.reset();
   return 0;